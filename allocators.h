@@ -0,0 +1,639 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Under AddressSanitizer BufferPool poisons the buffers it caches, so a use
+// after deallocation is still reported although the memory is not freed.
+#if defined(__SANITIZE_ADDRESS__)
+#define VECTOR_POOL_POISON 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define VECTOR_POOL_POISON 1
+#endif
+#endif
+
+#if defined(VECTOR_POOL_POISON)
+#include <sanitizer/asan_interface.h>
+#endif
+
+inline constexpr size_t kHugePageSize = size_t(2) << 20;
+
+namespace detail {
+
+// Byte size of n elements of T, throwing like operator new[] when it would
+// not fit in size_t. slack covers the rounding some allocators add on top.
+template <typename T>
+size_t AllocationBytes(size_t n, size_t slack = 0) {
+	if (n > (std::numeric_limits<size_t>::max() - slack) / sizeof(T)) {
+		throw std::bad_array_new_length();
+	}
+	return n * sizeof(T);
+}
+
+}
+
+// Allocates every buffer on an Alignment boundary through the aligned forms of
+// operator new. Useful for SIMD kernels that want cache-line aligned loads.
+template <typename T, size_t Alignment = kCacheLineSize>
+class AlignedAllocator {
+	static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+public:
+	using value_type = T;
+	using is_always_equal = std::true_type;
+
+	static constexpr size_t kAlignment = Alignment > alignof(T) ? Alignment : alignof(T);
+
+	template <typename U>
+	struct rebind {
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() noexcept = default;
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {
+
+	}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(operator new(detail::AllocationBytes<T>(n), std::align_val_t(kAlignment)));
+	}
+
+	void deallocate(T* buf, size_t) noexcept {
+		operator delete(buf, std::align_val_t(kAlignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept {
+		return false;
+	}
+};
+
+enum class HugePageMode {
+	// Anonymous mapping aligned to 2MB with madvise(MADV_HUGEPAGE).
+	kTransparent,
+	// MAP_HUGETLB from the reserved hugetlbfs pool, falling back to
+	// kTransparent when the pool is exhausted.
+	kExplicit,
+};
+
+// Serves blocks of at least Threshold bytes from huge-page backed mappings to
+// cut TLB misses on very large buffers. Smaller blocks come from
+// AlignedAllocator. On non-Linux targets every block takes the small path.
+template <typename T, HugePageMode Mode = HugePageMode::kTransparent, size_t Threshold = kHugePageSize>
+class HugePageAllocator {
+public:
+	using value_type = T;
+	using is_always_equal = std::true_type;
+
+	template <typename U>
+	struct rebind {
+		using other = HugePageAllocator<U, Mode, Threshold>;
+	};
+
+	HugePageAllocator() noexcept = default;
+
+	template <typename U>
+	HugePageAllocator(const HugePageAllocator<U, Mode, Threshold>&) noexcept {
+
+	}
+
+	T* allocate(size_t n) {
+#if defined(__linux__)
+		// MapHuge over-maps by up to two huge pages.
+		size_t bytes = detail::AllocationBytes<T>(n, 2 * kHugePageSize);
+		if (bytes >= Threshold) {
+			return static_cast<T*>(MapHuge(RoundUp(bytes)));
+		}
+#endif
+		return AlignedAllocator<T>().allocate(n);
+	}
+
+	void deallocate(T* buf, size_t n) noexcept {
+#if defined(__linux__)
+		if (n * sizeof(T) >= Threshold) {
+			munmap(buf, RoundUp(n * sizeof(T)));
+			return;
+		}
+#endif
+		AlignedAllocator<T>().deallocate(buf, n);
+	}
+
+	template <typename U>
+	bool operator==(const HugePageAllocator<U, Mode, Threshold>&) const noexcept {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const HugePageAllocator<U, Mode, Threshold>&) const noexcept {
+		return false;
+	}
+
+private:
+	static size_t RoundUp(size_t bytes) noexcept {
+		return (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+	}
+
+#if defined(__linux__)
+	static void* MapHuge(size_t bytes) {
+		if constexpr (Mode == HugePageMode::kExplicit) {
+			void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (addr != MAP_FAILED) {
+				return addr;
+			}
+		}
+
+		// Over-map by one huge page and trim both ends so the block starts on
+		// a 2MB boundary, otherwise the kernel cannot use huge pages for it.
+		size_t mapped = bytes + kHugePageSize;
+		void* addr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (addr == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+
+		char* raw = static_cast<char*>(addr);
+		char* aligned = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(raw)));
+		if (aligned != raw) {
+			munmap(raw, aligned - raw);
+		}
+		size_t tail = mapped - (aligned - raw) - bytes;
+		if (tail != 0) {
+			munmap(aligned + bytes, tail);
+		}
+
+		madvise(aligned, bytes, MADV_HUGEPAGE);
+		return aligned;
+	}
+#endif
+};
+
+enum class NumaPlacement {
+	// Whatever the thread's policy is, normally the first-touch node.
+	kDefault,
+	// All pages on the single node in the mask.
+	kBind,
+	// Pages spread round-robin over the nodes in the mask.
+	kInterleave,
+	// The block is cut into one contiguous slice per node, in node order. The
+	// parallel algorithms split ranges into equal contiguous chunks as well,
+	// so chunk i of a pass lands on slice i * nodes / chunks.
+	kPartition,
+};
+
+struct NumaPolicy {
+	NumaPlacement placement = NumaPlacement::kDefault;
+	// Bit i selects NUMA node i.
+	uint64_t nodes = 0;
+
+	// The node mask has 64 bits, so node must be in [0, 64).
+	static NumaPolicy Bind(int node) {
+		if (node < 0 || node >= 64) {
+			throw std::out_of_range("NumaPolicy::Bind: node out of range");
+		}
+		return {NumaPlacement::kBind, uint64_t(1) << node};
+	}
+
+	static NumaPolicy Interleave(uint64_t nodes) noexcept {
+		return {NumaPlacement::kInterleave, nodes};
+	}
+
+	static NumaPolicy Partition(uint64_t nodes) noexcept {
+		return {NumaPlacement::kPartition, nodes};
+	}
+};
+
+// Page-backed allocator that applies a NumaPolicy with mbind before any page
+// is touched. Blocks smaller than a page come from operator new and follow
+// the default policy. Deallocation does not depend on the policy, so all
+// instances compare equal; the policy follows the container on copy, move
+// and swap.
+template <typename T>
+class NumaAllocator {
+public:
+	using value_type = T;
+	using is_always_equal = std::true_type;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	NumaAllocator() noexcept = default;
+
+	explicit NumaAllocator(NumaPolicy policy) noexcept
+		: policy_(policy) {
+
+	}
+
+	template <typename U>
+	NumaAllocator(const NumaAllocator<U>& other) noexcept
+		: policy_(other.Policy()) {
+
+	}
+
+	T* allocate(size_t n) {
+#if defined(__linux__)
+		size_t bytes = detail::AllocationBytes<T>(n, PageSize());
+		if (bytes >= PageSize()) {
+			void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (addr == MAP_FAILED) {
+				throw std::bad_alloc();
+			}
+			Place(addr, (bytes + PageSize() - 1) / PageSize() * PageSize());
+			return static_cast<T*>(addr);
+		}
+#endif
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* buf, size_t n) noexcept {
+#if defined(__linux__)
+		if (n * sizeof(T) >= PageSize()) {
+			munmap(buf, n * sizeof(T));
+			return;
+		}
+#endif
+		std::allocator<T>().deallocate(buf, n);
+	}
+
+	const NumaPolicy& Policy() const noexcept {
+		return policy_;
+	}
+
+	template <typename U>
+	bool operator==(const NumaAllocator<U>&) const noexcept {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const NumaAllocator<U>&) const noexcept {
+		return false;
+	}
+
+private:
+#if defined(__linux__)
+	static constexpr int kMpolBind = 2;
+	static constexpr int kMpolInterleave = 3;
+
+	static size_t PageSize() noexcept {
+		static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return page;
+	}
+
+	// Placement is advisory: if the kernel rejects the policy, for example on
+	// a machine without those nodes, the block stays on the default policy.
+	static void Bind(void* addr, size_t bytes, int mode, uint64_t nodes) noexcept {
+		syscall(SYS_mbind, addr, bytes, mode, &nodes, sizeof(nodes) * 8 + 1, 0);
+	}
+
+	void Place(void* addr, size_t bytes) const noexcept {
+		switch (policy_.placement) {
+		case NumaPlacement::kDefault:
+			break;
+		case NumaPlacement::kBind:
+			Bind(addr, bytes, kMpolBind, policy_.nodes);
+			break;
+		case NumaPlacement::kInterleave:
+			Bind(addr, bytes, kMpolInterleave, policy_.nodes);
+			break;
+		case NumaPlacement::kPartition: {
+			size_t node_count = __builtin_popcountll(policy_.nodes);
+			if (node_count == 0) {
+				break;
+			}
+			size_t pages = bytes / PageSize();
+			size_t slice = 0;
+			for (int node = 0; node < 64; ++node) {
+				if ((policy_.nodes >> node & 1) == 0) {
+					continue;
+				}
+				size_t first = pages * slice / node_count;
+				size_t last = pages * (slice + 1) / node_count;
+				if (first < last) {
+					Bind(static_cast<char*>(addr) + first * PageSize(), (last - first) * PageSize(),
+						kMpolBind, uint64_t(1) << node);
+				}
+				++slice;
+			}
+			break;
+		}
+		}
+	}
+#endif
+
+	NumaPolicy policy_;
+};
+
+struct NumaRegion {
+	size_t offset;
+	size_t bytes;
+	// -1 for pages that have not been touched yet or cannot be queried.
+	int node;
+};
+
+// Reports which NUMA node backs each part of [addr, addr + bytes), merging
+// neighbouring pages on the same node into one region. Offsets are relative
+// to addr.
+inline Vector<NumaRegion> QueryNumaPlacement(const void* addr, size_t bytes) {
+	Vector<NumaRegion> regions;
+	if (bytes == 0) {
+		return regions;
+	}
+
+#if defined(__linux__)
+	size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	uintptr_t first = reinterpret_cast<uintptr_t>(addr) / page * page;
+	uintptr_t last = reinterpret_cast<uintptr_t>(addr) + bytes;
+	size_t count = (last - first + page - 1) / page;
+
+	Vector<void*> pages(count);
+	Vector<int> status(count);
+	for (size_t i = 0; i < count; ++i) {
+		pages[i] = reinterpret_cast<void*>(first + i * page);
+	}
+	if (syscall(SYS_move_pages, 0, count, pages.Data(), nullptr, status.Data(), 0) != 0) {
+		std::fill(status.begin(), status.end(), -1);
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		uintptr_t begin = std::max<uintptr_t>(first + i * page, reinterpret_cast<uintptr_t>(addr));
+		uintptr_t end = std::min<uintptr_t>(first + (i + 1) * page, last);
+		int node = status[i] >= 0 ? status[i] : -1;
+		if (regions.Size() != 0 && regions[regions.Size() - 1].node == node) {
+			regions[regions.Size() - 1].bytes += end - begin;
+		} else {
+			regions.PushBack(NumaRegion{begin - reinterpret_cast<uintptr_t>(addr), end - begin, node});
+		}
+	}
+#else
+	regions.PushBack(NumaRegion{0, bytes, -1});
+#endif
+	return regions;
+}
+
+template <typename Container>
+Vector<NumaRegion> QueryNumaPlacement(const Container& container) {
+	const auto* first = detail::ToAddress(container.begin());
+	return QueryNumaPlacement(first, (detail::ToAddress(container.end()) - first) * sizeof(*first));
+}
+
+// Per-thread cache of freed buffers, one free list per power-of-two size
+// class from kMinClassBytes to kMaxClassBytes; larger blocks bypass it. A
+// class keeps at most RetentionBytes() worth of buffers (at least one) and
+// frees the rest, so a burst does not pin memory for the life of the thread.
+// Every block comes from the same aligned operator new, so a buffer freed on
+// another thread simply joins that thread's cache. Counters are per thread
+// and unsynchronized, like the pool itself.
+class BufferPool {
+public:
+	static constexpr size_t kAlignment = kCacheLineSize;
+	static constexpr size_t kMinClassBytes = 64;
+	static constexpr size_t kMaxClassBytes = size_t(1) << 20;
+	static constexpr size_t kClassCount = 15;
+	static constexpr size_t kDefaultRetentionBytes = size_t(1) << 20;
+
+	struct ClassStats {
+		size_t bytes = 0;
+		size_t cached = 0;
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		// Buffers freed because the class was at its retention limit.
+		uint64_t evictions = 0;
+	};
+
+	BufferPool() noexcept {
+		for (size_t i = 0; i < kClassCount; ++i) {
+			classes_[i].stats.bytes = kMinClassBytes << i;
+		}
+	}
+
+	BufferPool(const BufferPool&) = delete;
+
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	~BufferPool() {
+		Trim();
+		destroyed_ = true;
+	}
+
+	// The calling thread's pool, or nullptr once it has been destroyed at
+	// thread exit; late frees then go straight to operator delete.
+	static BufferPool* Local() noexcept {
+		if (destroyed_) {
+			return nullptr;
+		}
+		thread_local BufferPool pool;
+		return &pool;
+	}
+
+	// Size class serving a block of `bytes`, or kClassCount if it is too big.
+	static constexpr size_t ClassOf(size_t bytes) noexcept {
+		size_t index = 0;
+		while (index < kClassCount && (kMinClassBytes << index) < bytes) {
+			++index;
+		}
+		return index;
+	}
+
+	// Bytes actually allocated for a block of `bytes`: its class size, or
+	// the request itself past the largest class. Every block of a class has
+	// this size whichever path allocated it, so any of them can be cached.
+	static constexpr size_t BlockBytes(size_t bytes) noexcept {
+		size_t index = ClassOf(bytes);
+		return index == kClassCount ? bytes : kMinClassBytes << index;
+	}
+
+	void* Allocate(size_t bytes) {
+		size_t index = ClassOf(bytes);
+		if (index == kClassCount) {
+			return operator new(bytes, std::align_val_t(kAlignment));
+		}
+
+		SizeClass& size_class = classes_[index];
+		if (size_class.head != nullptr) {
+			FreeBlock* block = size_class.head;
+			Unpoison(block, size_class.stats.bytes);
+			size_class.head = block->next;
+			--size_class.stats.cached;
+			++size_class.stats.hits;
+			return block;
+		}
+		++size_class.stats.misses;
+		return operator new(size_class.stats.bytes, std::align_val_t(kAlignment));
+	}
+
+	void Deallocate(void* buf, size_t bytes) noexcept {
+		size_t index = ClassOf(bytes);
+		if (index == kClassCount) {
+			operator delete(buf, std::align_val_t(kAlignment));
+			return;
+		}
+
+		SizeClass& size_class = classes_[index];
+		if (size_class.stats.cached >= Limit(size_class.stats.bytes)) {
+			++size_class.stats.evictions;
+			operator delete(buf, std::align_val_t(kAlignment));
+			return;
+		}
+		// A container may have poisoned the tail of the block it did not ask for.
+		Unpoison(buf, size_class.stats.bytes);
+		size_class.head = new (buf) FreeBlock{size_class.head};
+		Poison(buf, size_class.stats.bytes);
+		++size_class.stats.cached;
+	}
+
+	// Frees every cached buffer; the counters are kept.
+	void Trim() noexcept {
+		for (SizeClass& size_class : classes_) {
+			while (size_class.head != nullptr) {
+				FreeBlock* block = size_class.head;
+				Unpoison(block, size_class.stats.bytes);
+				size_class.head = block->next;
+				operator delete(block, std::align_val_t(kAlignment));
+			}
+			size_class.stats.cached = 0;
+		}
+	}
+
+	// Takes effect as buffers come back; call Trim to drop the excess now.
+	void SetRetentionBytes(size_t bytes) noexcept {
+		retention_bytes_ = bytes;
+	}
+
+	size_t RetentionBytes() const noexcept {
+		return retention_bytes_;
+	}
+
+	const ClassStats& Stats(size_t index) const noexcept {
+		assert(index < kClassCount);
+		return classes_[index].stats;
+	}
+
+	template <typename Function>
+	void ForEachClass(Function fn) const {
+		for (const SizeClass& size_class : classes_) {
+			fn(size_class.stats);
+		}
+	}
+
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	struct SizeClass {
+		FreeBlock* head = nullptr;
+		ClassStats stats;
+	};
+
+	size_t Limit(size_t class_bytes) const noexcept {
+		return std::max<size_t>(1, retention_bytes_ / class_bytes);
+	}
+
+	static void Poison(void* buf, size_t bytes) noexcept {
+#if defined(VECTOR_POOL_POISON)
+		ASAN_POISON_MEMORY_REGION(buf, bytes);
+#else
+		static_cast<void>(buf);
+		static_cast<void>(bytes);
+#endif
+	}
+
+	static void Unpoison(void* buf, size_t bytes) noexcept {
+#if defined(VECTOR_POOL_POISON)
+		ASAN_UNPOISON_MEMORY_REGION(buf, bytes);
+#else
+		static_cast<void>(buf);
+		static_cast<void>(bytes);
+#endif
+	}
+
+	// Trivially destructible, so it is still readable after the pool's
+	// destructor has run during thread exit.
+	inline static thread_local bool destroyed_ = false;
+
+	SizeClass classes_[kClassCount];
+	size_t retention_bytes_ = kDefaultRetentionBytes;
+
+};
+
+// Stateless allocator that draws buffers from the calling thread's
+// BufferPool. Requests are rounded up to their size class; with the
+// doubling growth policy and a power-of-two sizeof(T) every capacity fills
+// its class exactly, so short-lived vectors keep reusing the same few
+// buffers and the steady-state rate of operator new calls drops to about
+// zero.
+template <typename T>
+class PooledAllocator {
+	static_assert(alignof(T) <= BufferPool::kAlignment, "PooledAllocator does not support over-aligned types");
+
+public:
+	using value_type = T;
+	using is_always_equal = std::true_type;
+
+	template <typename U>
+	struct rebind {
+		using other = PooledAllocator<U>;
+	};
+
+	PooledAllocator() noexcept = default;
+
+	template <typename U>
+	PooledAllocator(const PooledAllocator<U>&) noexcept {
+
+	}
+
+	T* allocate(size_t n) {
+		size_t bytes = detail::AllocationBytes<T>(n);
+		BufferPool* pool = BufferPool::Local();
+		if (pool == nullptr) {
+			return static_cast<T*>(operator new(BufferPool::BlockBytes(bytes), std::align_val_t(BufferPool::kAlignment)));
+		}
+		return static_cast<T*>(pool->Allocate(bytes));
+	}
+
+	void deallocate(T* buf, size_t n) noexcept {
+		BufferPool* pool = BufferPool::Local();
+		if (pool == nullptr) {
+			operator delete(buf, std::align_val_t(BufferPool::kAlignment));
+			return;
+		}
+		pool->Deallocate(buf, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const PooledAllocator<U>&) const noexcept {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const PooledAllocator<U>&) const noexcept {
+		return false;
+	}
+};
+
+template <typename T, size_t Alignment = kCacheLineSize>
+using AlignedVector = Vector<T, AlignedAllocator<T, Alignment>>;
+
+template <typename T, HugePageMode Mode = HugePageMode::kTransparent>
+using HugePageVector = Vector<T, HugePageAllocator<T, Mode>>;
+
+template <typename T>
+using NumaVector = Vector<T, NumaAllocator<T>>;
+
+template <typename T>
+using PooledVector = Vector<T, PooledAllocator<T>, DoublingGrowthPolicy>;
@@ -0,0 +1,290 @@
+#include "vector.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+// Hot-path benchmarks for Vector with std::vector as the baseline. Run with
+// --benchmark_format=json (or build the bench_json target) to get output
+// that can be diffed between revisions.
+
+#ifndef VECTOR_BENCH_MAX_SIZE
+#define VECTOR_BENCH_MAX_SIZE 100000000
+#endif
+
+namespace {
+
+constexpr int64_t kMaxSize = VECTOR_BENCH_MAX_SIZE;
+// Single Emplace/Erase calls shift the tail, so they stop earlier.
+constexpr int64_t kMaxShiftSize = kMaxSize < 1000000 ? kMaxSize : 1000000;
+
+struct Trivial {
+	uint64_t value;
+};
+
+// Not trivially copyable, so relocation goes through the noexcept move.
+struct NothrowMovable {
+	NothrowMovable(uint64_t v = 0) noexcept
+		: value(v) {
+
+	}
+
+	NothrowMovable(const NothrowMovable& other)
+		: value(other.value) {
+
+	}
+
+	NothrowMovable(NothrowMovable&& other) noexcept
+		: value(other.value) {
+
+	}
+
+	NothrowMovable& operator=(const NothrowMovable& other) {
+		value = other.value;
+		return *this;
+	}
+
+	NothrowMovable& operator=(NothrowMovable&& other) noexcept {
+		value = other.value;
+		return *this;
+	}
+
+	~NothrowMovable() {
+
+	}
+
+	uint64_t value;
+};
+
+// Copyable only, with a copy that may throw: relocation has to copy.
+struct ThrowingCopy {
+	ThrowingCopy(uint64_t v = 0)
+		: value(v) {
+
+	}
+
+	ThrowingCopy(const ThrowingCopy& other) noexcept(false)
+		: value(other.value) {
+
+	}
+
+	ThrowingCopy& operator=(const ThrowingCopy& other) noexcept(false) {
+		value = other.value;
+		return *this;
+	}
+
+	~ThrowingCopy() {
+
+	}
+
+	uint64_t value;
+};
+
+template <typename Container>
+using ElementType = std::remove_reference_t<decltype(*std::declval<Container&>().begin())>;
+
+template <typename T>
+T MakeValue(size_t i) {
+	return T{static_cast<uint64_t>(i)};
+}
+
+// Hides the API spelling differences between Vector and std::vector.
+template <typename T>
+void BenchPushBack(Vector<T>& v, const T& value) {
+	v.PushBack(value);
+}
+
+template <typename T>
+void BenchPushBack(std::vector<T>& v, const T& value) {
+	v.push_back(value);
+}
+
+template <typename T>
+void BenchReserve(Vector<T>& v, size_t capacity) {
+	v.Reserve(capacity);
+}
+
+template <typename T>
+void BenchReserve(std::vector<T>& v, size_t capacity) {
+	v.reserve(capacity);
+}
+
+template <typename T>
+void BenchEmplaceMiddle(Vector<T>& v, const T& value) {
+	v.Emplace(v.begin() + v.Size() / 2, value);
+}
+
+template <typename T>
+void BenchEmplaceMiddle(std::vector<T>& v, const T& value) {
+	v.emplace(v.begin() + v.size() / 2, value);
+}
+
+template <typename T>
+void BenchEraseMiddle(Vector<T>& v) {
+	v.Erase(v.begin() + v.Size() / 2);
+}
+
+template <typename T>
+void BenchEraseMiddle(std::vector<T>& v) {
+	v.erase(v.begin() + v.size() / 2);
+}
+
+template <typename T>
+void BenchPopBack(Vector<T>& v) {
+	v.PopBack();
+}
+
+template <typename T>
+void BenchPopBack(std::vector<T>& v) {
+	v.pop_back();
+}
+
+template <typename Container>
+Container Filled(size_t n) {
+	using T = ElementType<Container>;
+	Container v;
+	BenchReserve(v, n);
+	for (size_t i = 0; i < n; ++i) {
+		BenchPushBack(v, MakeValue<T>(i));
+	}
+	return v;
+}
+
+template <typename Container>
+void SetCounters(benchmark::State& state, size_t items) {
+	using T = ElementType<Container>;
+	state.SetItemsProcessed(state.iterations() * items);
+	state.SetBytesProcessed(state.iterations() * items * sizeof(T));
+}
+
+template <typename Container>
+void BM_PushBack(benchmark::State& state) {
+	using T = ElementType<Container>;
+	size_t n = state.range(0);
+	for (auto _ : state) {
+		Container v;
+		for (size_t i = 0; i < n; ++i) {
+			BenchPushBack(v, MakeValue<T>(i));
+		}
+		benchmark::DoNotOptimize(v);
+	}
+	SetCounters<Container>(state, n);
+}
+
+template <typename Container>
+void BM_PushBackReserved(benchmark::State& state) {
+	using T = ElementType<Container>;
+	size_t n = state.range(0);
+	for (auto _ : state) {
+		Container v;
+		BenchReserve(v, n);
+		for (size_t i = 0; i < n; ++i) {
+			BenchPushBack(v, MakeValue<T>(i));
+		}
+		benchmark::DoNotOptimize(v);
+	}
+	SetCounters<Container>(state, n);
+}
+
+// Reallocation of a full vector to twice its size.
+template <typename Container>
+void BM_ReserveGrow(benchmark::State& state) {
+	size_t n = state.range(0);
+	for (auto _ : state) {
+		state.PauseTiming();
+		Container v = Filled<Container>(n);
+		state.ResumeTiming();
+		BenchReserve(v, 2 * n);
+		benchmark::DoNotOptimize(v);
+		state.PauseTiming();
+		v = Container();
+		state.ResumeTiming();
+	}
+	SetCounters<Container>(state, n);
+}
+
+// Each iteration inserts in the middle and drops the last element, so the
+// size stays at n and every call shifts half of the elements.
+template <typename Container>
+void BM_EmplaceMiddle(benchmark::State& state) {
+	using T = ElementType<Container>;
+	Container v = Filled<Container>(state.range(0));
+	BenchReserve(v, state.range(0) + 1);
+	T value = MakeValue<T>(0);
+	for (auto _ : state) {
+		BenchEmplaceMiddle(v, value);
+		BenchPopBack(v);
+		benchmark::ClobberMemory();
+	}
+	SetCounters<Container>(state, state.range(0) / 2);
+}
+
+template <typename Container>
+void BM_EraseMiddle(benchmark::State& state) {
+	using T = ElementType<Container>;
+	Container v = Filled<Container>(state.range(0));
+	BenchReserve(v, state.range(0) + 1);
+	T value = MakeValue<T>(0);
+	for (auto _ : state) {
+		BenchPushBack(v, value);
+		BenchEraseMiddle(v);
+		benchmark::ClobberMemory();
+	}
+	SetCounters<Container>(state, state.range(0) / 2);
+}
+
+// Copy assignment into an empty vector (allocates) and into one that
+// already holds n elements (assigns in place).
+template <typename Container>
+void BM_CopyAssign(benchmark::State& state) {
+	size_t n = state.range(0);
+	Container src = Filled<Container>(n);
+	for (auto _ : state) {
+		Container dst;
+		dst = src;
+		benchmark::DoNotOptimize(dst);
+	}
+	SetCounters<Container>(state, n);
+}
+
+template <typename Container>
+void BM_CopyAssignSameSize(benchmark::State& state) {
+	size_t n = state.range(0);
+	Container src = Filled<Container>(n);
+	Container dst = Filled<Container>(n);
+	for (auto _ : state) {
+		dst = src;
+		benchmark::DoNotOptimize(dst);
+	}
+	SetCounters<Container>(state, n);
+}
+
+void FullRange(benchmark::internal::Benchmark* b) {
+	b->RangeMultiplier(10)->Range(1, kMaxSize);
+}
+
+void ShiftRange(benchmark::internal::Benchmark* b) {
+	b->RangeMultiplier(10)->Range(1, kMaxShiftSize);
+}
+
+}
+
+#define VECTOR_BENCHMARK(Name, Type, Ranges) \
+	BENCHMARK_TEMPLATE(Name, Vector<Type>)->Apply(Ranges); \
+	BENCHMARK_TEMPLATE(Name, std::vector<Type>)->Apply(Ranges)
+
+#define VECTOR_BENCHMARKS(Type) \
+	VECTOR_BENCHMARK(BM_PushBack, Type, FullRange); \
+	VECTOR_BENCHMARK(BM_PushBackReserved, Type, FullRange); \
+	VECTOR_BENCHMARK(BM_ReserveGrow, Type, FullRange); \
+	VECTOR_BENCHMARK(BM_EmplaceMiddle, Type, ShiftRange); \
+	VECTOR_BENCHMARK(BM_EraseMiddle, Type, ShiftRange); \
+	VECTOR_BENCHMARK(BM_CopyAssign, Type, FullRange); \
+	VECTOR_BENCHMARK(BM_CopyAssignSameSize, Type, FullRange)
+
+VECTOR_BENCHMARKS(Trivial);
+VECTOR_BENCHMARKS(NothrowMovable);
+VECTOR_BENCHMARKS(ThrowingCopy);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "vector.h"
+
+#include <atomic>
+
+namespace detail {
+
+constexpr size_t FloorLog2(size_t value) noexcept {
+	size_t result = 0;
+	while (value >>= 1) {
+		++result;
+	}
+	return result;
+}
+
+}
+
+// Append-only vector for many concurrent producers. Storage is a list of
+// RawMemory segments whose sizes double, so elements never move and
+// references stay valid for the lifetime of the container.
+//
+// EmplaceBack reserves a slot with one fetch_add and is lock-free. Size() is
+// a wait-free snapshot: every element below it is fully constructed and
+// visible to the reader. Producers publish completed slots in index order,
+// helping each other advance the published size.
+template <typename T, typename Alloc = std::allocator<T>>
+class ConcurrentVector {
+	static constexpr size_t kFirstSegmentShift =
+		detail::FloorLog2(sizeof(T) < kCacheLineSize ? kCacheLineSize / sizeof(T) : 1);
+	static constexpr size_t kFirstSegmentSize = size_t(1) << kFirstSegmentShift;
+	static constexpr size_t kMaxSegments = sizeof(size_t) * 8 - kFirstSegmentShift;
+
+public:
+	explicit ConcurrentVector(const Alloc& alloc = Alloc())
+		: alloc_(alloc) {
+		for (std::atomic<Segment*>& segment : segments_) {
+			segment.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	ConcurrentVector(const ConcurrentVector&) = delete;
+
+	ConcurrentVector& operator=(const ConcurrentVector&) = delete;
+
+	~ConcurrentVector() {
+		size_t size = reserved_.load(std::memory_order_relaxed);
+		for (size_t k = 0; k < kMaxSegments; ++k) {
+			Segment* segment = segments_[k].load(std::memory_order_relaxed);
+			if (segment == nullptr) {
+				continue;
+			}
+			size_t first = SegmentStart(k);
+			if (first < size) {
+				std::destroy_n(segment->data.GetAddress(), std::min(size - first, SegmentSize(k)));
+			}
+			delete segment;
+		}
+	}
+
+	// Construction must not throw: a reserved slot that never gets an object
+	// would stop Size() from ever advancing past it. The same holds if the
+	// segment allocation fails, which is treated as fatal.
+	template <typename... Args>
+	T& EmplaceBack(Args&&... args) noexcept {
+		static_assert(std::is_nothrow_constructible_v<T, Args&&...>,
+			"ConcurrentVector elements must be constructed without throwing");
+
+		size_t index = reserved_.fetch_add(1, std::memory_order_relaxed);
+		auto [k, offset] = Locate(index);
+		Segment* segment = AcquireSegment(k);
+
+		T* slot = new (segment->data.GetAddress() + offset) T(std::forward<Args>(args)...);
+		segment->ready[offset].store(true);
+		Publish();
+		return *slot;
+	}
+
+	template <typename Type>
+	T& PushBack(Type&& value) {
+		return EmplaceBack(std::forward<Type>(value));
+	}
+
+	// Number of elements that are constructed and safe to read.
+	size_t Size() const noexcept {
+		return published_.load(std::memory_order_acquire);
+	}
+
+	const T& operator[](size_t index) const noexcept {
+		return const_cast<ConcurrentVector&>(*this)[index];
+	}
+
+	T& operator[](size_t index) noexcept {
+		assert(index < reserved_.load(std::memory_order_relaxed));
+		auto [k, offset] = Locate(index);
+		return segments_[k].load(std::memory_order_acquire)->data[offset];
+	}
+
+	// Calls fn(first, count) for each contiguous run of the elements below a
+	// Size() snapshot taken at the start of the call.
+	template <typename Function>
+	void ForEachSegment(Function fn) const {
+		size_t size = Size();
+		for (size_t k = 0; k < kMaxSegments && SegmentStart(k) < size; ++k) {
+			const T* first = segments_[k].load(std::memory_order_acquire)->data.GetAddress();
+			fn(first, std::min(size - SegmentStart(k), SegmentSize(k)));
+		}
+	}
+
+private:
+	struct Segment {
+		Segment(size_t size, const Alloc& alloc)
+			: data(size, alloc)
+			, ready(std::make_unique<std::atomic<bool>[]>(size)) {
+
+		}
+
+		RawMemory<T, Alloc> data;
+		std::unique_ptr<std::atomic<bool>[]> ready;
+	};
+
+	struct Location {
+		size_t segment;
+		size_t offset;
+	};
+
+	static constexpr size_t SegmentSize(size_t k) noexcept {
+		return kFirstSegmentSize << k;
+	}
+
+	static constexpr size_t SegmentStart(size_t k) noexcept {
+		return (kFirstSegmentSize << k) - kFirstSegmentSize;
+	}
+
+	static Location Locate(size_t index) noexcept {
+		size_t biased = index + kFirstSegmentSize;
+		size_t k = detail::FloorLog2(biased) - kFirstSegmentShift;
+		return {k, biased - (kFirstSegmentSize << k)};
+	}
+
+	// Returns segment k, allocating it if needed. Racing producers may each
+	// allocate one; the loser of the compare-exchange frees its copy.
+	Segment* AcquireSegment(size_t k) {
+		Segment* segment = segments_[k].load(std::memory_order_acquire);
+		if (segment != nullptr) {
+			return segment;
+		}
+
+		Segment* fresh = new Segment(SegmentSize(k), alloc_);
+		if (segments_[k].compare_exchange_strong(segment, fresh, std::memory_order_acq_rel)) {
+			return fresh;
+		}
+		delete fresh;
+		return segment;
+	}
+
+	// Sequentially consistent on purpose: a producer stores its ready flag
+	// and then reads published_, while the helper advancing published_ does
+	// the opposite. Weaker orders could let both miss each other and leave a
+	// completed slot unpublished.
+	void Publish() noexcept {
+		size_t published = published_.load();
+		while (published < reserved_.load()) {
+			auto [k, offset] = Locate(published);
+			Segment* segment = segments_[k].load();
+			if (segment == nullptr || !segment->ready[offset].load()) {
+				return;
+			}
+			if (published_.compare_exchange_weak(published, published + 1)) {
+				++published;
+			}
+		}
+	}
+
+	[[no_unique_address]] Alloc alloc_;
+	std::atomic<Segment*> segments_[kMaxSegments];
+	alignas(kCacheLineSize) std::atomic<size_t> reserved_{0};
+	alignas(kCacheLineSize) std::atomic<size_t> published_{0};
+
+};
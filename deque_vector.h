@@ -0,0 +1,374 @@
+#pragma once
+
+#include "vector.h"
+
+// Contiguous vector with spare capacity at both ends of one RawMemory block.
+// The elements occupy [head_, head_ + size_) of the buffer, so EmplaceFront
+// and PopFront are amortized O(1), and Emplace/Erase shift whichever side of
+// the position is shorter: a middle insertion moves at most n/2 elements.
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowthPolicy>
+class DequeVector {
+	using AllocTraits = std::allocator_traits<Alloc>;
+
+public:
+	using iterator = T*;
+	using const_iterator = const T*;
+	using allocator_type = Alloc;
+
+	DequeVector() noexcept(noexcept(Alloc()))
+		: data_(RawMemory<T, Alloc>()) {
+
+	}
+
+	explicit DequeVector(const Alloc& alloc) noexcept
+		: data_(RawMemory<T, Alloc>(alloc)) {
+
+	}
+
+	DequeVector(size_t size, const Alloc& alloc = Alloc())
+		: data_(RawMemory<T, Alloc>(size, alloc)), size_(size) {
+		std::uninitialized_value_construct_n(Data(), Size());
+	}
+
+	DequeVector(const DequeVector& other)
+		: DequeVector(other, AllocTraits::select_on_container_copy_construction(other.GetAllocator())) {
+
+	}
+
+	DequeVector(const DequeVector& other, const Alloc& alloc)
+		: data_(RawMemory<T, Alloc>(other.Size(), alloc)), size_(other.Size()) {
+		std::uninitialized_copy_n(other.Data(), Size(), Data());
+	}
+
+	DequeVector(DequeVector&& other) noexcept
+		: data_(std::move(other.data_))
+		, head_(std::exchange(other.head_, 0))
+		, size_(std::exchange(other.size_, 0)) {
+
+	}
+
+	DequeVector& operator=(const DequeVector& rhs) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		Clear();
+		if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+			if (GetAllocator() != rhs.GetAllocator()) {
+				data_.Reset(rhs.GetAllocator());
+			} else {
+				data_.SetAllocator(rhs.GetAllocator());
+			}
+		}
+		if (rhs.Size() > data_.Capacity()) {
+			RawMemory<T, Alloc> new_data(rhs.Size(), GetAllocator());
+			data_.Swap(new_data);
+		}
+		head_ = 0;
+		std::uninitialized_copy_n(rhs.Data(), rhs.Size(), Data());
+		size_ = rhs.Size();
+		return *this;
+	}
+
+	DequeVector& operator=(DequeVector&& rhs) noexcept(AllocTraits::propagate_on_container_move_assignment::value
+		|| AllocTraits::is_always_equal::value) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		Clear();
+		bool can_steal = true;
+		if constexpr (!AllocTraits::propagate_on_container_move_assignment::value
+			&& !AllocTraits::is_always_equal::value) {
+			can_steal = GetAllocator() == rhs.GetAllocator();
+		}
+
+		if (can_steal) {
+			data_ = std::move(rhs.data_);
+			head_ = std::exchange(rhs.head_, 0);
+			size_ = std::exchange(rhs.size_, 0);
+		} else {
+			Reserve(rhs.Size());
+			std::uninitialized_move_n(rhs.Data(), rhs.Size(), Data());
+			size_ = rhs.Size();
+			rhs.Clear();
+		}
+		return *this;
+	}
+
+	~DequeVector() {
+		std::destroy_n(Data(), Size());
+	}
+
+	iterator begin() noexcept {
+		return Data();
+	}
+
+	iterator end() noexcept {
+		return Data() + Size();
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return Data();
+	}
+
+	const_iterator cend() const noexcept {
+		return Data() + Size();
+	}
+
+	T* Data() noexcept {
+		return data_.GetAddress() + head_;
+	}
+
+	const T* Data() const noexcept {
+		return data_.GetAddress() + head_;
+	}
+
+	template <typename... Args>
+	iterator Emplace(const_iterator position, Args&&... args) {
+		size_t pos = position - cbegin();
+		if (pos == Size()) {
+			EmplaceBack(std::forward<Args>(args)...);
+			return begin() + pos;
+		}
+		if (pos == 0) {
+			EmplaceFront(std::forward<Args>(args)...);
+			return begin();
+		}
+
+		bool toward_front = pos < Size() - pos;
+		if (toward_front ? FrontCapacity() == 0 : BackCapacity() == 0) {
+			Grow(pos, [&](T* slot) {
+				new (slot) T(std::forward<Args>(args)...);
+			});
+			return begin() + pos;
+		}
+
+		T tmp_obj(std::forward<Args>(args)...);
+		T* first = Data();
+		if (toward_front) {
+			if constexpr (kMemMovable) {
+				detail::MemMoveN(first, pos, first - 1);
+				new (first - 1 + pos) T(std::move(tmp_obj));
+				--head_;
+				++size_;
+			} else {
+				new (first - 1) T(std::move(first[0]));
+				--head_;
+				++size_;
+				std::move(first + 1, first + pos, first);
+				first[pos - 1] = std::move(tmp_obj);
+			}
+		} else {
+			T* last = first + Size();
+			if constexpr (kMemMovable) {
+				detail::MemMoveN(first + pos, Size() - pos, first + pos + 1);
+				new (first + pos) T(std::move(tmp_obj));
+				++size_;
+			} else {
+				new (last) T(std::move(last[-1]));
+				++size_;
+				std::move_backward(first + pos, last - 1, last);
+				first[pos] = std::move(tmp_obj);
+			}
+		}
+		return begin() + pos;
+	}
+
+	iterator Insert(const_iterator position, const T& value) {
+		return Emplace(position, value);
+	}
+
+	iterator Insert(const_iterator position, T&& value) {
+		return Emplace(position, std::move(value));
+	}
+
+	iterator Erase(const_iterator position) {
+		size_t pos = position - cbegin();
+		T* first = Data();
+		if (pos < Size() - pos - 1) {
+			if constexpr (IsTriviallyRelocatableV<T>) {
+				std::destroy_at(first + pos);
+				detail::MemMoveN(first, pos, first + 1);
+			} else {
+				std::move_backward(first, first + pos, first + pos + 1);
+				std::destroy_at(first);
+			}
+			++head_;
+		} else {
+			if constexpr (IsTriviallyRelocatableV<T>) {
+				std::destroy_at(first + pos);
+				detail::MemMoveN(first + pos + 1, Size() - pos - 1, first + pos);
+			} else {
+				std::move(first + pos + 1, first + Size(), first + pos);
+				std::destroy_at(first + Size() - 1);
+			}
+		}
+		--size_;
+		return begin() + pos;
+	}
+
+	template <typename... Args>
+	T& EmplaceBack(Args&&... args) {
+		if (BackCapacity() != 0) {
+			new (Data() + Size()) T(std::forward<Args>(args)...);
+			++size_;
+		} else {
+			Grow(Size(), [&](T* slot) {
+				new (slot) T(std::forward<Args>(args)...);
+			});
+		}
+		return Data()[Size() - 1];
+	}
+
+	template <typename Type>
+	void PushBack(Type&& value) {
+		EmplaceBack(std::forward<Type>(value));
+	}
+
+	void PopBack() noexcept {
+		assert(size_ != 0);
+		std::destroy_at(Data() + Size() - 1);
+		--size_;
+	}
+
+	template <typename... Args>
+	T& EmplaceFront(Args&&... args) {
+		if (FrontCapacity() != 0) {
+			new (Data() - 1) T(std::forward<Args>(args)...);
+			--head_;
+			++size_;
+		} else {
+			Grow(0, [&](T* slot) {
+				new (slot) T(std::forward<Args>(args)...);
+			});
+		}
+		return Data()[0];
+	}
+
+	template <typename Type>
+	void PushFront(Type&& value) {
+		EmplaceFront(std::forward<Type>(value));
+	}
+
+	void PopFront() noexcept {
+		assert(size_ != 0);
+		std::destroy_at(Data());
+		++head_;
+		--size_;
+	}
+
+	void Resize(size_t new_size) {
+		if (new_size < Size()) {
+			std::destroy_n(Data() + new_size, Size() - new_size);
+		} else if (new_size > Size()) {
+			Reserve(new_size);
+			std::uninitialized_value_construct_n(Data() + Size(), new_size - Size());
+		}
+		size_ = new_size;
+	}
+
+	// Makes room for capacity elements from the current front, so the back
+	// can grow to that size without reallocating.
+	void Reserve(size_t capacity) {
+		if (data_.Capacity() - head_ >= capacity) {
+			return;
+		}
+		Relocate(head_, head_ + capacity);
+	}
+
+	// Makes room for count elements in front of the first one.
+	void ReserveFront(size_t count) {
+		if (head_ >= count) {
+			return;
+		}
+		Relocate(count, count + Size() + BackCapacity());
+	}
+
+	void Clear() noexcept {
+		std::destroy_n(Data(), Size());
+		size_ = 0;
+	}
+
+	void Swap(DequeVector& other) noexcept {
+		data_.Swap(other.data_);
+		std::swap(head_, other.head_);
+		std::swap(size_, other.size_);
+	}
+
+	size_t Size() const noexcept {
+		return size_;
+	}
+
+	size_t Capacity() const noexcept {
+		return data_.Capacity();
+	}
+
+	// Free slots before the first element.
+	size_t FrontCapacity() const noexcept {
+		return head_;
+	}
+
+	// Free slots after the last element.
+	size_t BackCapacity() const noexcept {
+		return data_.Capacity() - head_ - size_;
+	}
+
+	const Alloc& GetAllocator() const noexcept {
+		return data_.GetAllocator();
+	}
+
+	const T& operator[](size_t index) const noexcept {
+		return const_cast<DequeVector&>(*this)[index];
+	}
+
+	T& operator[](size_t index) noexcept {
+		assert(index < size_);
+		return Data()[index];
+	}
+
+private:
+	static constexpr bool kMemMovable = IsTriviallyRelocatableV<T> && std::is_nothrow_move_constructible_v<T>;
+
+	// Moves the elements to a new buffer with a one-slot gap at pos, built
+	// by construct, and centers them so both ends get spare capacity. The
+	// buffer only grows when at least half of the current one is in use;
+	// otherwise it is recentered, which keeps queue-like use (PushBack with
+	// PopFront) from growing without bound.
+	template <typename Construct>
+	void Grow(size_t pos, Construct construct) {
+		size_t required = Size() + 1;
+		size_t capacity = required <= data_.Capacity() / 2
+			? data_.Capacity()
+			: Growth::template NextCapacity<T>(data_.Capacity(), required);
+		size_t head = (capacity - required) / 2;
+
+		RawMemory<T, Alloc> new_data(capacity, GetAllocator());
+		T* dst = new_data.GetAddress() + head;
+		construct(dst + pos);
+		detail::RelocateAroundN(Data(), Size(), pos, dst);
+		data_.Swap(new_data);
+		head_ = head;
+		++size_;
+	}
+
+	void Relocate(size_t head, size_t capacity) {
+		RawMemory<T, Alloc> new_data(capacity, GetAllocator());
+		detail::UninitializedRelocateN(Data(), Size(), new_data.GetAddress() + head);
+		data_.Swap(new_data);
+		head_ = head;
+	}
+
+	RawMemory<T, Alloc> data_;
+	size_t head_ = 0;
+	size_t size_ = 0;
+
+};
@@ -0,0 +1,368 @@
+#pragma once
+
+#include "flat_set.h"
+
+#include <stdexcept>
+
+// Sorted-vector map with the keys and the values in separate Vectors, so a
+// search only touches keys. Iterators yield std::pair<const K&, V&> proxies.
+template <typename K, typename V, typename Compare = std::less<K>, typename Layout = BinarySearchLayout>
+class FlatMap {
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<K, V>;
+
+	template <bool Const>
+	class Iterator {
+		using Value = std::conditional_t<Const, const V, V>;
+
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = FlatMap::value_type;
+		using difference_type = ptrdiff_t;
+		using reference = std::pair<const K&, Value&>;
+		using pointer = void;
+
+		Iterator() noexcept = default;
+
+		Iterator(const K* key, Value* value) noexcept
+			: key_(key), value_(value) {
+
+		}
+
+		operator Iterator<true>() const noexcept {
+			return Iterator<true>(key_, value_);
+		}
+
+		reference operator*() const noexcept {
+			return reference(*key_, *value_);
+		}
+
+		reference operator[](difference_type offset) const noexcept {
+			return reference(key_[offset], value_[offset]);
+		}
+
+		const K& Key() const noexcept {
+			return *key_;
+		}
+
+		Value& Mapped() const noexcept {
+			return *value_;
+		}
+
+		Iterator& operator++() noexcept {
+			++key_;
+			++value_;
+			return *this;
+		}
+
+		Iterator operator++(int) noexcept {
+			Iterator it = *this;
+			++*this;
+			return it;
+		}
+
+		Iterator& operator--() noexcept {
+			--key_;
+			--value_;
+			return *this;
+		}
+
+		Iterator operator--(int) noexcept {
+			Iterator it = *this;
+			--*this;
+			return it;
+		}
+
+		Iterator& operator+=(difference_type offset) noexcept {
+			key_ += offset;
+			value_ += offset;
+			return *this;
+		}
+
+		Iterator& operator-=(difference_type offset) noexcept {
+			return *this += -offset;
+		}
+
+		friend Iterator operator+(Iterator it, difference_type offset) noexcept {
+			return it += offset;
+		}
+
+		friend Iterator operator+(difference_type offset, Iterator it) noexcept {
+			return it += offset;
+		}
+
+		friend Iterator operator-(Iterator it, difference_type offset) noexcept {
+			return it -= offset;
+		}
+
+		friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.key_ - rhs.key_;
+		}
+
+		friend bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.key_ == rhs.key_;
+		}
+
+		friend bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.key_ != rhs.key_;
+		}
+
+		friend bool operator<(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.key_ < rhs.key_;
+		}
+
+		friend bool operator>(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.key_ > rhs.key_;
+		}
+
+		friend bool operator<=(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.key_ <= rhs.key_;
+		}
+
+		friend bool operator>=(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.key_ >= rhs.key_;
+		}
+
+	private:
+		const K* key_ = nullptr;
+		Value* value_ = nullptr;
+	};
+
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+	FlatMap() = default;
+
+	explicit FlatMap(const Compare& comp)
+		: comp_(comp) {
+
+	}
+
+	// Builds the map from unsorted (key, value) pairs with one sort and one
+	// dedup pass; for duplicate keys the first pair wins.
+	template <typename InputIt, typename = std::enable_if_t<detail::IsInputIteratorV<InputIt>>>
+	FlatMap(InputIt first, InputIt last, const Compare& comp = Compare())
+		: comp_(comp) {
+		Vector<value_type> rows = SortedRows(first, last);
+		keys_.Reserve(rows.Size());
+		values_.Reserve(rows.Size());
+		for (value_type& row : rows) {
+			keys_.EmplaceBack(std::move(row.first));
+			values_.EmplaceBack(std::move(row.second));
+		}
+		Reindex();
+	}
+
+	FlatMap(std::initializer_list<value_type> rows, const Compare& comp = Compare())
+		: FlatMap(rows.begin(), rows.end(), comp) {
+
+	}
+
+	iterator begin() noexcept {
+		return iterator(keys_.Data(), values_.Data());
+	}
+
+	iterator end() noexcept {
+		return iterator(keys_.Data() + keys_.Size(), values_.Data() + values_.Size());
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return const_iterator(keys_.Data(), values_.Data());
+	}
+
+	const_iterator cend() const noexcept {
+		return const_iterator(keys_.Data() + keys_.Size(), values_.Data() + values_.Size());
+	}
+
+	// Inserts (key, V(args...)) unless the key is present already.
+	template <typename... Args>
+	std::pair<iterator, bool> Emplace(const K& key, Args&&... args) {
+		size_t pos = LowerBoundIndex(key);
+		if (pos != keys_.Size() && !comp_(key, keys_[pos])) {
+			return {IteratorAt(pos), false};
+		}
+		InsertAt(pos, key, std::forward<Args>(args)...);
+		return {IteratorAt(pos), true};
+	}
+
+	std::pair<iterator, bool> Insert(const K& key, const V& value) {
+		return Emplace(key, value);
+	}
+
+	template <typename Type>
+	std::pair<iterator, bool> InsertOrAssign(const K& key, Type&& value) {
+		auto [it, inserted] = Emplace(key, std::forward<Type>(value));
+		if (!inserted) {
+			it.Mapped() = std::forward<Type>(value);
+		}
+		return {it, inserted};
+	}
+
+	// Sorts and dedups the batch, then merges it with the existing entries in
+	// one linear pass. Entries already present keep their values.
+	template <typename InputIt>
+	void InsertRange(InputIt first, InputIt last) {
+		Vector<value_type> rows = SortedRows(first, last);
+
+		Vector<K> keys;
+		Vector<V> values;
+		keys.Reserve(keys_.Size() + rows.Size());
+		values.Reserve(keys_.Size() + rows.Size());
+		size_t lhs = 0;
+		value_type* rhs = rows.Data();
+		value_type* rhs_end = rhs + rows.Size();
+		while (lhs != keys_.Size() || rhs != rhs_end) {
+			if (lhs == keys_.Size() || (rhs != rhs_end && comp_(rhs->first, keys_[lhs]))) {
+				keys.EmplaceBack(std::move(rhs->first));
+				values.EmplaceBack(std::move(rhs->second));
+				++rhs;
+			} else {
+				if (rhs != rhs_end && !comp_(keys_[lhs], rhs->first)) {
+					++rhs;
+				}
+				keys.EmplaceBack(std::move(keys_[lhs]));
+				values.EmplaceBack(std::move(values_[lhs]));
+				++lhs;
+			}
+		}
+		keys_.Swap(keys);
+		values_.Swap(values);
+		Reindex();
+	}
+
+	V& operator[](const K& key) {
+		return Emplace(key).first.Mapped();
+	}
+
+	V& At(const K& key) {
+		return const_cast<V&>(static_cast<const FlatMap&>(*this).At(key));
+	}
+
+	const V& At(const K& key) const {
+		const_iterator it = Find(key);
+		if (it == end()) {
+			throw std::out_of_range("FlatMap::At: key not found");
+		}
+		return it.Mapped();
+	}
+
+	iterator Erase(const_iterator position) {
+		size_t pos = &position.Key() - keys_.Data();
+		values_.Erase(values_.begin() + pos);
+		keys_.Erase(keys_.begin() + pos);
+		Reindex();
+		return IteratorAt(pos);
+	}
+
+	size_t Erase(const K& key) {
+		const_iterator it = Find(key);
+		if (it == end()) {
+			return 0;
+		}
+		Erase(it);
+		return 1;
+	}
+
+	iterator Find(const K& key) {
+		return IteratorAt(FindIndex(key));
+	}
+
+	const_iterator Find(const K& key) const {
+		size_t pos = FindIndex(key);
+		return const_iterator(keys_.Data() + pos, values_.Data() + pos);
+	}
+
+	bool Contains(const K& key) const {
+		return FindIndex(key) != keys_.Size();
+	}
+
+	size_t Count(const K& key) const {
+		return Contains(key) ? 1 : 0;
+	}
+
+	iterator LowerBound(const K& key) {
+		return IteratorAt(LowerBoundIndex(key));
+	}
+
+	void Reserve(size_t capacity) {
+		keys_.Reserve(capacity);
+		values_.Reserve(capacity);
+	}
+
+	void Clear() noexcept {
+		keys_.Clear();
+		values_.Clear();
+		index_.Clear();
+	}
+
+	size_t Size() const noexcept {
+		return keys_.Size();
+	}
+
+	const Vector<K>& Keys() const noexcept {
+		return keys_;
+	}
+
+	const Vector<V>& Values() const noexcept {
+		return values_;
+	}
+
+private:
+	template <typename InputIt>
+	Vector<value_type> SortedRows(InputIt first, InputIt last) const {
+		Vector<value_type> rows;
+		rows.Assign(first, last);
+		detail::SortUnique(rows, [this](const value_type& lhs, const value_type& rhs) {
+			return comp_(lhs.first, rhs.first);
+		});
+		return rows;
+	}
+
+	iterator IteratorAt(size_t pos) noexcept {
+		return iterator(keys_.Data() + pos, values_.Data() + pos);
+	}
+
+	size_t LowerBoundIndex(const K& key) const {
+		return index_.LowerBound(keys_, key, comp_);
+	}
+
+	size_t FindIndex(const K& key) const {
+		size_t pos = LowerBoundIndex(key);
+		if (pos != keys_.Size() && !comp_(key, keys_[pos])) {
+			return pos;
+		}
+		return keys_.Size();
+	}
+
+	template <typename... Args>
+	void InsertAt(size_t pos, const K& key, Args&&... args) {
+		values_.Emplace(values_.begin() + pos, std::forward<Args>(args)...);
+		try {
+			keys_.Insert(keys_.begin() + pos, key);
+		} catch (...) {
+			values_.Erase(values_.begin() + pos);
+			throw;
+		}
+		Reindex();
+	}
+
+	void Reindex() {
+		index_.Build(keys_);
+	}
+
+	Vector<K> keys_;
+	Vector<V> values_;
+	typename Layout::template Index<K, Compare> index_;
+	[[no_unique_address]] Compare comp_;
+
+};
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "vector.h"
+
+#include <functional>
+#include <initializer_list>
+
+// Search layouts for the flat containers. A layout keeps whatever index it
+// needs next to the sorted keys and answers LowerBound with a position in
+// the sorted order. Build is called after every modification.
+
+// Plain binary search over the sorted keys; needs no extra memory.
+struct BinarySearchLayout {
+	template <typename K, typename Compare>
+	class Index {
+	public:
+		void Build(const Vector<K>&) {
+
+		}
+
+		void Clear() noexcept {
+
+		}
+
+		size_t LowerBound(const Vector<K>& keys, const K& key, const Compare& comp) const {
+			return std::lower_bound(keys.begin(), keys.end(), key, comp) - keys.begin();
+		}
+	};
+};
+
+// Keeps a second copy of the keys in Eytzinger (BFS) order, so the first
+// levels of every search share a few cache lines and later levels can be
+// prefetched. Costs one key and one index per element and an O(n) rebuild
+// per modification, which suits read-mostly tables.
+struct EytzingerLayout {
+	template <typename K, typename Compare>
+	class Index {
+		static_assert(std::is_default_constructible_v<K> && std::is_copy_assignable_v<K>,
+			"EytzingerLayout needs default-constructible, copy-assignable keys");
+
+	public:
+		void Build(const Vector<K>& sorted) {
+			Vector<K> keys(sorted.Size());
+			Vector<size_t> ranks(sorted.Size());
+			size_t next = 0;
+			Fill(sorted, keys, ranks, 1, next);
+			keys_.Swap(keys);
+			ranks_.Swap(ranks);
+		}
+
+		void Clear() noexcept {
+			keys_.Clear();
+			ranks_.Clear();
+		}
+
+		// Walks down the implicit tree (children of node k are 2k and 2k + 1),
+		// then undoes the trailing right turns plus one to reach the last node
+		// where the search went left, which is the lower bound.
+		size_t LowerBound(const Vector<K>& sorted, const K& key, const Compare& comp) const {
+			size_t n = keys_.Size();
+			size_t k = 1;
+			while (k <= n) {
+#if defined(__GNUC__)
+				__builtin_prefetch(keys_.Data() + std::min(kPrefetchAhead * k, n) - 1);
+#endif
+				k = 2 * k + (comp(keys_[k - 1], key) ? 1 : 0);
+			}
+			while (k & 1) {
+				k >>= 1;
+			}
+			k >>= 1;
+			return k == 0 ? sorted.Size() : ranks_[k - 1];
+		}
+
+	private:
+		// Node k's descendants four levels down form 16 consecutive slots.
+		static constexpr size_t kPrefetchAhead = 16;
+
+		static void Fill(const Vector<K>& sorted, Vector<K>& keys, Vector<size_t>& ranks, size_t k, size_t& next) {
+			if (k > sorted.Size()) {
+				return;
+			}
+			Fill(sorted, keys, ranks, 2 * k, next);
+			keys[k - 1] = sorted[next];
+			ranks[k - 1] = next++;
+			Fill(sorted, keys, ranks, 2 * k + 1, next);
+		}
+
+		Vector<K> keys_;
+		Vector<size_t> ranks_;
+	};
+};
+
+namespace detail {
+
+// Stable sort followed by removal of equivalent neighbours, so the first
+// occurrence of every key in the input is the one that survives.
+template <typename T, typename Less>
+void SortUnique(Vector<T>& items, Less less) {
+	std::stable_sort(items.begin(), items.end(), less);
+	auto last = std::unique(items.begin(), items.end(), [&less](const T& lhs, const T& rhs) {
+		return !less(lhs, rhs);
+	});
+	items.Erase(last, items.end());
+}
+
+}
+
+// Sorted-vector set. Lookups are O(log n) over contiguous memory; single
+// insertions and erasures shift the tail, so prefer the bulk constructor or
+// InsertRange when adding many keys.
+template <typename K, typename Compare = std::less<K>, typename Layout = BinarySearchLayout>
+class FlatSet {
+public:
+	using value_type = K;
+	using iterator = const K*;
+	using const_iterator = const K*;
+
+	FlatSet() = default;
+
+	explicit FlatSet(const Compare& comp)
+		: comp_(comp) {
+
+	}
+
+	// Builds the set from unsorted input with one sort and one dedup pass.
+	template <typename InputIt, typename = std::enable_if_t<detail::IsInputIteratorV<InputIt>>>
+	FlatSet(InputIt first, InputIt last, const Compare& comp = Compare())
+		: comp_(comp) {
+		keys_.Assign(first, last);
+		detail::SortUnique(keys_, comp_);
+		index_.Build(keys_);
+	}
+
+	FlatSet(std::initializer_list<K> keys, const Compare& comp = Compare())
+		: FlatSet(keys.begin(), keys.end(), comp) {
+
+	}
+
+	const_iterator begin() const noexcept {
+		return keys_.Data();
+	}
+
+	const_iterator end() const noexcept {
+		return keys_.Data() + keys_.Size();
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> Emplace(Args&&... args) {
+		return Insert(K(std::forward<Args>(args)...));
+	}
+
+	std::pair<iterator, bool> Insert(const K& key) {
+		return Insert(K(key));
+	}
+
+	std::pair<iterator, bool> Insert(K&& key) {
+		size_t pos = LowerBoundIndex(key);
+		if (pos != keys_.Size() && !comp_(key, keys_[pos])) {
+			return {keys_.Data() + pos, false};
+		}
+		keys_.Insert(keys_.begin() + pos, std::move(key));
+		Reindex();
+		return {keys_.Data() + pos, true};
+	}
+
+	// Sorts and dedups the batch, then merges it with the existing keys in
+	// one linear pass. Keys already present are kept.
+	template <typename InputIt>
+	void InsertRange(InputIt first, InputIt last) {
+		Vector<K> batch;
+		batch.Assign(first, last);
+		detail::SortUnique(batch, comp_);
+
+		Vector<K> merged;
+		merged.Reserve(keys_.Size() + batch.Size());
+		K* lhs = keys_.Data();
+		K* lhs_end = lhs + keys_.Size();
+		K* rhs = batch.Data();
+		K* rhs_end = rhs + batch.Size();
+		while (lhs != lhs_end && rhs != rhs_end) {
+			if (comp_(*rhs, *lhs)) {
+				merged.EmplaceBack(std::move(*rhs++));
+			} else {
+				if (!comp_(*lhs, *rhs)) {
+					++rhs;
+				}
+				merged.EmplaceBack(std::move(*lhs++));
+			}
+		}
+		merged.Append(std::make_move_iterator(lhs), std::make_move_iterator(lhs_end));
+		merged.Append(std::make_move_iterator(rhs), std::make_move_iterator(rhs_end));
+		keys_.Swap(merged);
+		Reindex();
+	}
+
+	iterator Erase(const_iterator position) {
+		size_t pos = position - keys_.Data();
+		keys_.Erase(keys_.begin() + pos);
+		Reindex();
+		return keys_.Data() + pos;
+	}
+
+	size_t Erase(const K& key) {
+		const_iterator it = Find(key);
+		if (it == end()) {
+			return 0;
+		}
+		Erase(it);
+		return 1;
+	}
+
+	const_iterator Find(const K& key) const {
+		size_t pos = LowerBoundIndex(key);
+		if (pos != keys_.Size() && !comp_(key, keys_[pos])) {
+			return keys_.Data() + pos;
+		}
+		return end();
+	}
+
+	bool Contains(const K& key) const {
+		return Find(key) != end();
+	}
+
+	size_t Count(const K& key) const {
+		return Contains(key) ? 1 : 0;
+	}
+
+	const_iterator LowerBound(const K& key) const {
+		return keys_.Data() + LowerBoundIndex(key);
+	}
+
+	const_iterator UpperBound(const K& key) const {
+		return std::upper_bound(begin(), end(), key, comp_);
+	}
+
+	void Reserve(size_t capacity) {
+		keys_.Reserve(capacity);
+	}
+
+	void Clear() noexcept {
+		keys_.Clear();
+		index_.Clear();
+	}
+
+	size_t Size() const noexcept {
+		return keys_.Size();
+	}
+
+	const Vector<K>& Keys() const noexcept {
+		return keys_;
+	}
+
+	const K& operator[](size_t index) const noexcept {
+		return keys_[index];
+	}
+
+private:
+	size_t LowerBoundIndex(const K& key) const {
+		return index_.LowerBound(keys_, key, comp_);
+	}
+
+	void Reindex() {
+		index_.Build(keys_);
+	}
+
+	Vector<K> keys_;
+	typename Layout::template Index<K, Compare> index_;
+	[[no_unique_address]] Compare comp_;
+
+};
@@ -0,0 +1,359 @@
+#pragma once
+
+#include "vector.h"
+
+// Contiguous vector whose growth does not move everything at once. When the
+// buffer is full, EmplaceBack allocates the next one, constructs the new
+// element there and leaves the old elements where they are; every later
+// EmplaceBack then relocates a bounded batch of them, like incremental
+// rehashing, sized so the migration ends before the new buffer fills up.
+// Until then operator[] routes each index to the buffer that holds it, and
+// Migrate lets the owner drain the old buffer from an idle point instead.
+//
+// Storage is contiguous again once IsMigrating() is false; Data() finishes
+// the migration first. Erase-like operations in the middle go through the
+// regular O(n) path and finish it as well.
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowthPolicy>
+class IncrementalVector {
+	using AllocTraits = std::allocator_traits<Alloc>;
+
+public:
+	using iterator = detail::IndexIterator<IncrementalVector, T>;
+	using const_iterator = detail::IndexIterator<const IncrementalVector, const T>;
+	using allocator_type = Alloc;
+
+	// Lower bound on the elements relocated per EmplaceBack, so the old
+	// buffer is released well before the new one fills up.
+	static constexpr size_t kMinMigrationStep = 8;
+
+	IncrementalVector() noexcept(noexcept(Alloc()))
+		: data_(RawMemory<T, Alloc>()), old_(RawMemory<T, Alloc>()) {
+
+	}
+
+	explicit IncrementalVector(const Alloc& alloc) noexcept
+		: data_(RawMemory<T, Alloc>(alloc)), old_(RawMemory<T, Alloc>(alloc)) {
+
+	}
+
+	IncrementalVector(const IncrementalVector& other)
+		: IncrementalVector(AllocTraits::select_on_container_copy_construction(other.GetAllocator())) {
+		AppendFrom(other);
+	}
+
+	IncrementalVector(IncrementalVector&& other) noexcept
+		: data_(std::move(other.data_))
+		, old_(std::move(other.old_))
+		, size_(std::exchange(other.size_, 0))
+		, old_size_(std::exchange(other.old_size_, 0))
+		, migrated_(std::exchange(other.migrated_, 0))
+		, step_(std::exchange(other.step_, 0)) {
+
+	}
+
+	IncrementalVector& operator=(const IncrementalVector& rhs) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		Clear();
+		if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+			if (GetAllocator() != rhs.GetAllocator()) {
+				data_.Reset(rhs.GetAllocator());
+				old_.Reset(rhs.GetAllocator());
+			} else {
+				data_.SetAllocator(rhs.GetAllocator());
+				old_.SetAllocator(rhs.GetAllocator());
+			}
+		}
+		AppendFrom(rhs);
+		return *this;
+	}
+
+	IncrementalVector& operator=(IncrementalVector&& rhs) noexcept(AllocTraits::propagate_on_container_move_assignment::value
+		|| AllocTraits::is_always_equal::value) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		Clear();
+		bool can_steal = true;
+		if constexpr (!AllocTraits::propagate_on_container_move_assignment::value
+			&& !AllocTraits::is_always_equal::value) {
+			can_steal = GetAllocator() == rhs.GetAllocator();
+		}
+
+		if (can_steal) {
+			data_ = std::move(rhs.data_);
+			old_ = std::move(rhs.old_);
+			size_ = std::exchange(rhs.size_, 0);
+			old_size_ = std::exchange(rhs.old_size_, 0);
+			migrated_ = std::exchange(rhs.migrated_, 0);
+			step_ = std::exchange(rhs.step_, 0);
+		} else {
+			Reserve(rhs.Size());
+			for (size_t i = 0; i < rhs.Size(); ++i) {
+				EmplaceBack(std::move(rhs[i]));
+			}
+			rhs.Clear();
+		}
+		return *this;
+	}
+
+	~IncrementalVector() {
+		DestroyAll();
+	}
+
+	iterator begin() noexcept {
+		return iterator(this, 0);
+	}
+
+	iterator end() noexcept {
+		return iterator(this, Size());
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return const_iterator(this, 0);
+	}
+
+	const_iterator cend() const noexcept {
+		return const_iterator(this, Size());
+	}
+
+	// Contiguous view of the elements; finishes a pending migration.
+	T* Data() {
+		FinishMigration();
+		return data_.GetAddress();
+	}
+
+	template <typename... Args>
+	T& EmplaceBack(Args&&... args) {
+		if (Size() == data_.Capacity()) {
+			Grow(std::forward<Args>(args)...);
+		} else {
+			// Built before migrating, since args may refer to an element that
+			// the step is about to relocate.
+			T* slot = data_.GetAddress() + Size();
+			new (slot) T(std::forward<Args>(args)...);
+			MigrateOrUndo(step_, slot);
+			++size_;
+		}
+		return data_[Size() - 1];
+	}
+
+	template <typename Type>
+	void PushBack(Type&& value) {
+		EmplaceBack(std::forward<Type>(value));
+	}
+
+	void PopBack() noexcept {
+		VECTOR_CHECK(size_ != 0, "PopBack on an empty IncrementalVector");
+		std::destroy_at(&(*this)[Size() - 1]);
+		--size_;
+		if (Size() < old_size_) {
+			old_size_ = Size();
+			if (migrated_ >= old_size_) {
+				ReleaseOld();
+			}
+		}
+	}
+
+	template <typename... Args>
+	iterator Emplace(const_iterator position, Args&&... args) {
+		size_t pos = position.Index();
+		if (pos == Size()) {
+			EmplaceBack(std::forward<Args>(args)...);
+			return begin() + pos;
+		}
+
+		// args may refer to an element that is about to be relocated.
+		T tmp_obj(std::forward<Args>(args)...);
+		FinishMigration();
+		if (Size() == data_.Capacity()) {
+			Reallocate(NextCapacity(Size() + 1));
+		}
+		detail::EmplaceShift(data_.GetAddress(), size_, pos, std::move(tmp_obj));
+		return begin() + pos;
+	}
+
+	iterator Erase(const_iterator position) {
+		size_t pos = position.Index();
+		VECTOR_CHECK(pos < Size(), "Erase of the end iterator");
+		FinishMigration();
+		detail::EraseShiftN(data_.GetAddress(), Size(), pos, 1);
+		--size_;
+		return begin() + pos;
+	}
+
+	void Resize(size_t new_size) {
+		while (Size() > new_size) {
+			PopBack();
+		}
+		while (Size() < new_size) {
+			EmplaceBack();
+		}
+	}
+
+	// Reserve is an explicit request for room, so it relocates everything
+	// right away.
+	void Reserve(size_t capacity) {
+		if (data_.Capacity() >= capacity) {
+			return;
+		}
+		FinishMigration();
+		Reallocate(capacity);
+	}
+
+	void Clear() noexcept {
+		DestroyAll();
+		size_ = 0;
+		ReleaseOld();
+	}
+
+	void Swap(IncrementalVector& other) noexcept {
+		data_.Swap(other.data_);
+		old_.Swap(other.old_);
+		std::swap(size_, other.size_);
+		std::swap(old_size_, other.old_size_);
+		std::swap(migrated_, other.migrated_);
+		std::swap(step_, other.step_);
+	}
+
+	bool IsMigrating() const noexcept {
+		return old_size_ != 0;
+	}
+
+	// Relocates up to max_count elements out of the old buffer and returns
+	// whether any are left there.
+	bool Migrate(size_t max_count) {
+		size_t count = std::min(max_count, old_size_ - migrated_);
+		detail::UninitializedRelocateN(old_.GetAddress() + migrated_, count, data_.GetAddress() + migrated_);
+		migrated_ += count;
+		if (migrated_ == old_size_) {
+			ReleaseOld();
+		}
+		return IsMigrating();
+	}
+
+	void FinishMigration() {
+		if (IsMigrating()) {
+			Migrate(old_size_);
+		}
+	}
+
+	size_t Size() const noexcept {
+		return size_;
+	}
+
+	size_t Capacity() const noexcept {
+		return data_.Capacity();
+	}
+
+	const Alloc& GetAllocator() const noexcept {
+		return data_.GetAllocator();
+	}
+
+	const T& operator[](size_t index) const noexcept {
+		return const_cast<IncrementalVector&>(*this)[index];
+	}
+
+	// Elements in [migrated_, old_size_) are still in the old buffer. One
+	// unsigned comparison covers both bounds and is false when nothing is
+	// migrating.
+	T& operator[](size_t index) noexcept {
+		VECTOR_CHECK(index < size_, "IncrementalVector index out of range");
+		if (index - migrated_ < old_size_ - migrated_) {
+			return old_[index];
+		}
+		return data_[index];
+	}
+
+private:
+	size_t NextCapacity(size_t required) const noexcept {
+		return Growth::template NextCapacity<T>(data_.Capacity(), required);
+	}
+
+	// Builds the new element at its final index in the next buffer and makes
+	// the current one the old buffer. The step size normally completes the
+	// previous migration before this point; draining the rest is a safety
+	// net and runs only after args have been consumed.
+	template <typename... Args>
+	void Grow(Args&&... args) {
+		RawMemory<T, Alloc> new_data(NextCapacity(Size() + 1), GetAllocator());
+		T* slot = new_data.GetAddress() + Size();
+		new (slot) T(std::forward<Args>(args)...);
+		MigrateOrUndo(old_size_, slot);
+
+		old_.Swap(data_);
+		data_.Swap(new_data);
+		old_size_ = Size();
+		migrated_ = 0;
+		size_t pushes_left = data_.Capacity() - Size() - 1;
+		step_ = std::max(kMinMigrationStep, pushes_left == 0 ? old_size_ : (old_size_ + pushes_left - 1) / pushes_left);
+		++size_;
+		if (old_size_ == 0) {
+			ReleaseOld();
+		}
+	}
+
+	// Migrates up to max_count elements once the new, not yet counted
+	// element at slot has been built. If a relocating copy throws, that
+	// element is destroyed again so the insertion has no effect.
+	void MigrateOrUndo(size_t max_count, T* slot) {
+		if (!IsMigrating()) {
+			return;
+		}
+		if constexpr (detail::IsNothrowRelocatableV<T>) {
+			Migrate(max_count);
+		} else {
+			try {
+				Migrate(max_count);
+			} catch (...) {
+				std::destroy_at(slot);
+				throw;
+			}
+		}
+	}
+
+	void Reallocate(size_t capacity) {
+		RawMemory<T, Alloc> new_data(capacity, GetAllocator());
+		detail::UninitializedRelocateN(data_.GetAddress(), Size(), new_data.GetAddress());
+		data_.Swap(new_data);
+	}
+
+	void ReleaseOld() noexcept {
+		RawMemory<T, Alloc> empty(GetAllocator());
+		old_.Swap(empty);
+		old_size_ = 0;
+		migrated_ = 0;
+	}
+
+	void DestroyAll() noexcept {
+		std::destroy_n(data_.GetAddress(), migrated_);
+		std::destroy_n(old_.GetAddress() + migrated_, old_size_ - migrated_);
+		std::destroy_n(data_.GetAddress() + old_size_, Size() - old_size_);
+	}
+
+	void AppendFrom(const IncrementalVector& other) {
+		Reserve(Size() + other.Size());
+		for (size_t i = 0; i < other.Size(); ++i) {
+			EmplaceBack(other[i]);
+		}
+	}
+
+	RawMemory<T, Alloc> data_;
+	RawMemory<T, Alloc> old_;
+	size_t size_ = 0;
+	size_t old_size_ = 0;
+	size_t migrated_ = 0;
+	size_t step_ = 0;
+
+};
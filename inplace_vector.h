@@ -0,0 +1,307 @@
+#pragma once
+
+#include "vector.h"
+
+#include <initializer_list>
+
+namespace detail {
+
+// Inline element storage for InplaceVector, chosen by what the element type
+// allows: trivial types live in a plain array, so every operation works in
+// constant expressions under C++20; other trivially copyable types keep the
+// defaulted, trivial copies over raw bytes; everything else copies, moves and
+// destroys element-wise.
+template <typename T, size_t N>
+class InplaceArrayStorage {
+public:
+	// The array is left uninitialized at run time, so constructing an empty
+	// vector costs nothing. Constant evaluation may not copy indeterminate
+	// values, so there every slot is value-initialized.
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201907L
+	constexpr InplaceArrayStorage() noexcept {
+		if (IsConstantEvaluated()) {
+			for (T& element : elements_) {
+				element = T();
+			}
+		}
+	}
+#else
+	InplaceArrayStorage() = default;
+#endif
+
+	constexpr T* Elements() noexcept {
+		return elements_;
+	}
+
+	constexpr const T* Elements() const noexcept {
+		return elements_;
+	}
+
+protected:
+	size_t size_ = 0;
+
+private:
+	T elements_[N == 0 ? 1 : N];
+};
+
+template <typename T, size_t N>
+class InplaceByteStorage {
+public:
+	T* Elements() noexcept {
+		return std::launder(reinterpret_cast<T*>(bytes_));
+	}
+
+	const T* Elements() const noexcept {
+		return std::launder(reinterpret_cast<const T*>(bytes_));
+	}
+
+protected:
+	size_t size_ = 0;
+
+private:
+	alignas(T) unsigned char bytes_[sizeof(T) * (N == 0 ? 1 : N)];
+};
+
+template <typename T, size_t N>
+class InplaceOwningStorage : public InplaceByteStorage<T, N> {
+	using Base = InplaceByteStorage<T, N>;
+
+public:
+	InplaceOwningStorage() = default;
+
+	InplaceOwningStorage(const InplaceOwningStorage& other) {
+		std::uninitialized_copy_n(other.Elements(), other.size_, this->Elements());
+		this->size_ = other.size_;
+	}
+
+	InplaceOwningStorage(InplaceOwningStorage&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+		std::uninitialized_move_n(other.Elements(), other.size_, this->Elements());
+		this->size_ = other.size_;
+	}
+
+	InplaceOwningStorage& operator=(const InplaceOwningStorage& rhs) {
+		if (this != &rhs) {
+			AssignFrom(rhs.Elements(), rhs.size_);
+		}
+		return *this;
+	}
+
+	InplaceOwningStorage& operator=(InplaceOwningStorage&& rhs) noexcept(std::is_nothrow_move_assignable_v<T>
+		&& std::is_nothrow_move_constructible_v<T>) {
+		if (this != &rhs) {
+			AssignFrom(rhs.Elements(), rhs.size_);
+		}
+		return *this;
+	}
+
+	~InplaceOwningStorage() {
+		std::destroy_n(this->Elements(), this->size_);
+	}
+
+private:
+	// Assigns over the common prefix, then constructs or destroys the rest.
+	// Copies from a const source and moves from a mutable one.
+	template <typename Source>
+	void AssignFrom(Source* src, size_t count) {
+		T* dst = this->Elements();
+		size_t common = std::min(this->size_, count);
+		if constexpr (std::is_const_v<Source>) {
+			std::copy_n(src, common, dst);
+		} else {
+			std::move(src, src + common, dst);
+		}
+
+		if (count < this->size_) {
+			std::destroy_n(dst + count, this->size_ - count);
+		} else if constexpr (std::is_const_v<Source>) {
+			std::uninitialized_copy_n(src + common, count - common, dst + common);
+		} else {
+			std::uninitialized_move_n(src + common, count - common, dst + common);
+		}
+		this->size_ = count;
+	}
+};
+
+template <typename T, size_t N>
+using InplaceStorage = std::conditional_t<std::is_trivial_v<T>, InplaceArrayStorage<T, N>,
+	std::conditional_t<std::is_trivially_copyable_v<T>, InplaceByteStorage<T, N>, InplaceOwningStorage<T, N>>>;
+
+}
+
+// Vector with a fixed capacity of N elements stored inline; it never
+// allocates. Growing past N is a precondition violation for EmplaceBack,
+// Emplace and Resize, while TryEmplaceBack/TryPushBack report it by
+// returning nullptr. Inserts and erases share their element shuffling with
+// Vector. The container is trivially copyable when T is, and for trivial T
+// it can be built and modified in constant expressions under C++20.
+template <typename T, size_t N>
+class InplaceVector : private detail::InplaceStorage<T, N> {
+	using Storage = detail::InplaceStorage<T, N>;
+	using Storage::size_;
+
+public:
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	InplaceVector() = default;
+
+	constexpr explicit InplaceVector(size_t size)
+		: InplaceVector() {
+		Resize(size);
+	}
+
+	constexpr InplaceVector(std::initializer_list<T> items)
+		: InplaceVector() {
+		VECTOR_CHECK(items.size() <= N, "InplaceVector initializer list exceeds its capacity");
+		for (const T& item : items) {
+			EmplaceBack(item);
+		}
+	}
+
+	constexpr iterator begin() noexcept {
+		return Data();
+	}
+
+	constexpr iterator end() noexcept {
+		return Data() + Size();
+	}
+
+	constexpr const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	constexpr const_iterator end() const noexcept {
+		return cend();
+	}
+
+	constexpr const_iterator cbegin() const noexcept {
+		return Data();
+	}
+
+	constexpr const_iterator cend() const noexcept {
+		return Data() + Size();
+	}
+
+	constexpr T* Data() noexcept {
+		return this->Elements();
+	}
+
+	constexpr const T* Data() const noexcept {
+		return this->Elements();
+	}
+
+	template <typename... Args>
+	constexpr iterator Emplace(const_iterator position, Args&&... args) {
+		size_t pos = position - cbegin();
+		VECTOR_CHECK(pos <= Size(), "Emplace position out of range");
+		VECTOR_CHECK(Size() < N, "Emplace into a full InplaceVector");
+		detail::EmplaceShift(Data(), size_, pos, std::forward<Args>(args)...);
+		return begin() + pos;
+	}
+
+	constexpr iterator Insert(const_iterator position, const T& value) {
+		return Emplace(position, value);
+	}
+
+	constexpr iterator Insert(const_iterator position, T&& value) {
+		return Emplace(position, std::move(value));
+	}
+
+	constexpr iterator Erase(const_iterator position) {
+		size_t pos = position - cbegin();
+		VECTOR_CHECK(pos < Size(), "Erase of the end iterator");
+		detail::EraseShiftN(Data(), Size(), pos, 1);
+		--size_;
+		return begin() + pos;
+	}
+
+	constexpr iterator Erase(const_iterator first, const_iterator last) {
+		VECTOR_CHECK(first <= last, "Erase range is reversed");
+		size_t pos = first - cbegin();
+		size_t count = last - first;
+		VECTOR_CHECK(pos <= Size() && count <= Size() - pos, "Erase range out of range");
+		if (count != 0) {
+			detail::EraseShiftN(Data(), Size(), pos, count);
+			size_ -= count;
+		}
+		return begin() + pos;
+	}
+
+	template <typename... Args>
+	constexpr T& EmplaceBack(Args&&... args) {
+		VECTOR_CHECK(Size() < N, "EmplaceBack on a full InplaceVector");
+		T* slot = Data() + Size();
+		detail::ConstructAt(slot, std::forward<Args>(args)...);
+		++size_;
+		return *slot;
+	}
+
+	template <typename Type>
+	constexpr void PushBack(Type&& value) {
+		EmplaceBack(std::forward<Type>(value));
+	}
+
+	// Returns the new element, or nullptr without touching the arguments if
+	// the vector is full.
+	template <typename... Args>
+	constexpr T* TryEmplaceBack(Args&&... args) {
+		if (Size() == N) {
+			return nullptr;
+		}
+		return &EmplaceBack(std::forward<Args>(args)...);
+	}
+
+	template <typename Type>
+	constexpr T* TryPushBack(Type&& value) {
+		return TryEmplaceBack(std::forward<Type>(value));
+	}
+
+	constexpr void PopBack() noexcept {
+		VECTOR_CHECK(Size() != 0, "PopBack on an empty InplaceVector");
+		--size_;
+		detail::DestroyN(Data() + Size(), 1);
+	}
+
+	constexpr void Resize(size_t new_size) {
+		VECTOR_CHECK(new_size <= N, "Resize beyond the InplaceVector capacity");
+		if (new_size < Size()) {
+			detail::DestroyN(Data() + new_size, Size() - new_size);
+			size_ = new_size;
+		}
+		while (Size() < new_size) {
+			detail::ConstructAt(Data() + Size());
+			++size_;
+		}
+	}
+
+	constexpr void Clear() noexcept {
+		detail::DestroyN(Data(), Size());
+		size_ = 0;
+	}
+
+	void Swap(InplaceVector& other) noexcept(std::is_nothrow_move_constructible_v<T>
+		&& std::is_nothrow_move_assignable_v<T>) {
+		InplaceVector tmp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(tmp);
+	}
+
+	constexpr size_t Size() const noexcept {
+		return size_;
+	}
+
+	static constexpr size_t Capacity() noexcept {
+		return N;
+	}
+
+	constexpr const T& operator[](size_t index) const noexcept {
+		VECTOR_CHECK(index < Size(), "InplaceVector index out of range");
+		return Data()[index];
+	}
+
+	constexpr T& operator[](size_t index) noexcept {
+		VECTOR_CHECK(index < Size(), "InplaceVector index out of range");
+		return Data()[index];
+	}
+
+};
@@ -0,0 +1,352 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <typeinfo>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Identifies the element type stored in a mapped file. The default mixes the
+// compiler's type name with the size and alignment; specialize it to get a
+// hash that is stable across toolchains.
+template <typename T>
+struct MappedTypeHash {
+	static uint64_t Value() noexcept {
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : std::string_view(typeid(T).name())) {
+			hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+		}
+		hash = (hash ^ sizeof(T)) * 1099511628211ull;
+		return (hash ^ alignof(T)) * 1099511628211ull;
+	}
+};
+
+struct MappedVectorHeader {
+	static constexpr uint64_t kMagic = 0x524f544345564d4dull;
+	static constexpr uint32_t kVersion = 1;
+
+	uint64_t magic;
+	uint32_t version;
+	uint32_t element_size;
+	uint64_t type_hash;
+	uint64_t size;
+	uint64_t capacity;
+};
+
+enum class MappedVectorMode {
+	// Maps an existing file read-only; nothing is copied at open time.
+	kReadOnly,
+	// Opens an existing file for update or creates an empty one.
+	kReadWrite,
+	// Creates the file, discarding any previous contents.
+	kTruncate,
+};
+
+// Vector of trivially copyable records whose storage is a MAP_SHARED mapping
+// of a file: a MappedVectorHeader followed by the elements. Growth extends
+// the file with ftruncate and remaps it, so the contents persist across runs.
+template <typename T, typename Growth = DefaultGrowthPolicy>
+class MappedVector {
+	static_assert(std::is_trivially_copyable_v<T>, "MappedVector stores elements as raw bytes");
+
+public:
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	explicit MappedVector(const std::string& path, MappedVectorMode mode = MappedVectorMode::kReadWrite)
+		: read_only_(mode == MappedVectorMode::kReadOnly) {
+		int flags = read_only_ ? O_RDONLY : O_RDWR | O_CREAT;
+		if (mode == MappedVectorMode::kTruncate) {
+			flags |= O_TRUNC;
+		}
+
+		fd_ = open(path.c_str(), flags | O_CLOEXEC, 0644);
+		if (fd_ < 0) {
+			throw std::system_error(errno, std::generic_category(), "open " + path);
+		}
+
+		try {
+			struct stat st;
+			if (fstat(fd_, &st) != 0) {
+				throw std::system_error(errno, std::generic_category(), "fstat " + path);
+			}
+
+			if (st.st_size == 0 && !read_only_) {
+				Initialize();
+			} else {
+				Attach(static_cast<size_t>(st.st_size));
+			}
+		} catch (...) {
+			Close();
+			throw;
+		}
+	}
+
+	MappedVector(const MappedVector&) = delete;
+
+	MappedVector& operator=(const MappedVector&) = delete;
+
+	MappedVector(MappedVector&& other) noexcept
+		: fd_(std::exchange(other.fd_, -1))
+		, base_(std::exchange(other.base_, nullptr))
+		, mapped_bytes_(std::exchange(other.mapped_bytes_, 0))
+		, read_only_(other.read_only_) {
+
+	}
+
+	MappedVector& operator=(MappedVector&& rhs) noexcept {
+		if (this != &rhs) {
+			Close();
+			fd_ = std::exchange(rhs.fd_, -1);
+			base_ = std::exchange(rhs.base_, nullptr);
+			mapped_bytes_ = std::exchange(rhs.mapped_bytes_, 0);
+			read_only_ = rhs.read_only_;
+		}
+		return *this;
+	}
+
+	~MappedVector() {
+		Close();
+	}
+
+	iterator begin() noexcept {
+		return Data();
+	}
+
+	iterator end() noexcept {
+		return Data() + Size();
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return Data();
+	}
+
+	const_iterator cend() const noexcept {
+		return Data() + Size();
+	}
+
+	template <typename... Args>
+	T& EmplaceBack(Args&&... args) {
+		CheckWritable();
+		if (Size() == Capacity()) {
+			// args may point into the mapping that Remap is about to move.
+			T tmp_obj(std::forward<Args>(args)...);
+			Remap(Growth::template NextCapacity<T>(Capacity(), Size() + 1));
+			new (end()) T(tmp_obj);
+		} else {
+			new (end()) T(std::forward<Args>(args)...);
+		}
+		return Data()[Header()->size++];
+	}
+
+	void PushBack(const T& value) {
+		EmplaceBack(value);
+	}
+
+	void PopBack() {
+		CheckWritable();
+		VECTOR_CHECK(Size() != 0, "PopBack on an empty MappedVector");
+		Header()->size--;
+	}
+
+	iterator Erase(const_iterator position) {
+		CheckWritable();
+		size_t pos = position - cbegin();
+		VECTOR_CHECK(pos < Size(), "Erase of the end iterator");
+		detail::MemMoveN(begin() + pos + 1, Size() - pos - 1, begin() + pos);
+		Header()->size--;
+		return begin() + pos;
+	}
+
+	void Resize(size_t new_size) {
+		CheckWritable();
+		Reserve(new_size);
+		if (new_size > Size()) {
+			std::uninitialized_value_construct_n(end(), new_size - Size());
+		}
+		Header()->size = new_size;
+	}
+
+	void Reserve(size_t capacity) {
+		CheckWritable();
+		if (Capacity() < capacity) {
+			Remap(capacity);
+		}
+	}
+
+	void Clear() {
+		CheckWritable();
+		Header()->size = 0;
+	}
+
+	// Writes dirty pages back to the file. With async the call only schedules
+	// the write-back.
+	void Flush(bool async = false) {
+		if (read_only_ || base_ == nullptr) {
+			return;
+		}
+		if (msync(base_, mapped_bytes_, async ? MS_ASYNC : MS_SYNC) != 0) {
+			throw std::system_error(errno, std::generic_category(), "msync");
+		}
+	}
+
+	// A moved-from vector has no mapping and reports zero for both.
+	size_t Size() const noexcept {
+		return base_ != nullptr ? Header()->size : 0;
+	}
+
+	size_t Capacity() const noexcept {
+		return base_ != nullptr ? Header()->capacity : 0;
+	}
+
+	bool IsReadOnly() const noexcept {
+		return read_only_;
+	}
+
+	const T* GetAddress() const noexcept {
+		return Data();
+	}
+
+	T* GetAddress() noexcept {
+		return Data();
+	}
+
+	const T& operator[](size_t index) const noexcept {
+		return const_cast<MappedVector&>(*this)[index];
+	}
+
+	T& operator[](size_t index) noexcept {
+		VECTOR_CHECK(index < Size(), "MappedVector index out of range");
+		return Data()[index];
+	}
+
+private:
+	static constexpr size_t kHeaderAlignment = std::max(alignof(T), kCacheLineSize);
+	static constexpr size_t kHeaderBytes =
+		(sizeof(MappedVectorHeader) + kHeaderAlignment - 1) / kHeaderAlignment * kHeaderAlignment;
+
+	static size_t FileBytes(size_t capacity) {
+		size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return (kHeaderBytes + capacity * sizeof(T) + page - 1) / page * page;
+	}
+
+	MappedVectorHeader* Header() const noexcept {
+		return reinterpret_cast<MappedVectorHeader*>(base_);
+	}
+
+	T* Data() const noexcept {
+		return base_ != nullptr ? reinterpret_cast<T*>(base_ + kHeaderBytes) : nullptr;
+	}
+
+	// The pages of a read-only mapping are PROT_READ, so writing to them
+	// would fault; a moved-from vector has nothing to write to.
+	void CheckWritable() const {
+		if (read_only_) {
+			throw std::logic_error("MappedVector: modification of a read-only mapping");
+		}
+		if (fd_ < 0) {
+			throw std::logic_error("MappedVector: use of a moved-from vector");
+		}
+	}
+
+	void Initialize() {
+		size_t bytes = FileBytes(0);
+		if (ftruncate(fd_, bytes) != 0) {
+			throw std::system_error(errno, std::generic_category(), "ftruncate");
+		}
+		Map(bytes);
+
+		MappedVectorHeader* header = Header();
+		header->magic = MappedVectorHeader::kMagic;
+		header->version = MappedVectorHeader::kVersion;
+		header->element_size = sizeof(T);
+		header->type_hash = MappedTypeHash<T>::Value();
+		header->size = 0;
+		header->capacity = (bytes - kHeaderBytes) / sizeof(T);
+	}
+
+	void Attach(size_t file_bytes) {
+		if (file_bytes < kHeaderBytes) {
+			throw std::runtime_error("MappedVector: file is too small for a header");
+		}
+		Map(file_bytes);
+
+		const MappedVectorHeader* header = Header();
+		if (header->magic != MappedVectorHeader::kMagic || header->version != MappedVectorHeader::kVersion) {
+			throw std::runtime_error("MappedVector: unknown file format");
+		}
+		if (header->element_size != sizeof(T) || header->type_hash != MappedTypeHash<T>::Value()) {
+			throw std::runtime_error("MappedVector: element type mismatch");
+		}
+		if (header->size > header->capacity || header->capacity > (file_bytes - kHeaderBytes) / sizeof(T)) {
+			throw std::runtime_error("MappedVector: corrupted header");
+		}
+	}
+
+	void Map(size_t bytes) {
+		int prot = read_only_ ? PROT_READ : PROT_READ | PROT_WRITE;
+		void* addr = mmap(nullptr, bytes, prot, MAP_SHARED, fd_, 0);
+		if (addr == MAP_FAILED) {
+			throw std::system_error(errno, std::generic_category(), "mmap");
+		}
+		base_ = static_cast<char*>(addr);
+		mapped_bytes_ = bytes;
+	}
+
+	void Remap(size_t capacity) {
+		size_t bytes = FileBytes(capacity);
+		if (ftruncate(fd_, bytes) != 0) {
+			throw std::system_error(errno, std::generic_category(), "ftruncate");
+		}
+
+#if defined(__linux__)
+		void* addr = mremap(base_, mapped_bytes_, bytes, MREMAP_MAYMOVE);
+		if (addr == MAP_FAILED) {
+			throw std::system_error(errno, std::generic_category(), "mremap");
+		}
+		base_ = static_cast<char*>(addr);
+		mapped_bytes_ = bytes;
+#else
+		char* old_base = base_;
+		size_t old_bytes = mapped_bytes_;
+		Map(bytes);
+		munmap(old_base, old_bytes);
+#endif
+		Header()->capacity = (bytes - kHeaderBytes) / sizeof(T);
+	}
+
+	void Close() noexcept {
+		if (base_ != nullptr) {
+			munmap(base_, mapped_bytes_);
+			base_ = nullptr;
+			mapped_bytes_ = 0;
+		}
+		if (fd_ >= 0) {
+			close(fd_);
+			fd_ = -1;
+		}
+	}
+
+	int fd_ = -1;
+	char* base_ = nullptr;
+	size_t mapped_bytes_ = 0;
+	bool read_only_ = false;
+
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+// Parallel algorithms over contiguous containers (Vector, SmallVector,
+// MappedVector, ...). The range is split into chunks whose boundaries fall on
+// cache-line boundaries, so no two workers ever write to the same line.
+
+class ParallelPolicy {
+public:
+	explicit ParallelPolicy(ThreadPool& pool = ThreadPool::Default()) noexcept
+		: pool_(&pool) {
+
+	}
+
+	size_t Concurrency() const noexcept {
+		return pool_->Size();
+	}
+
+	template <typename Body>
+	void ParallelFor(size_t tasks, Body&& body) const {
+		pool_->ParallelFor(tasks, std::forward<Body>(body));
+	}
+
+	ThreadPool& Pool() const noexcept {
+		return *pool_;
+	}
+
+private:
+	ThreadPool* pool_;
+};
+
+template <>
+struct IsExecutionPolicy<ParallelPolicy> : std::true_type {};
+
+// Policy for the parallel Vector overloads: Vector(n, value, Par()),
+// v.Reserve(n, Par(pool)), v.Copy(Par()).
+inline ParallelPolicy Par(ThreadPool& pool = ThreadPool::Default()) noexcept {
+	return ParallelPolicy(pool);
+}
+
+namespace detail {
+
+// Calls body(begin, end) for every chunk of [first, first + n).
+template <typename T, typename Body>
+void ForEachChunk(T* first, size_t n, ThreadPool& pool, Body&& body) {
+	size_t chunks = ChunkCount<T>(n, pool.Size());
+	pool.ParallelFor(chunks, [&](size_t i) {
+		size_t begin = ChunkBoundary(first, n, chunks, i);
+		size_t end = ChunkBoundary(first, n, chunks, i + 1);
+		if (begin < end) {
+			body(begin, end);
+		}
+	});
+}
+
+}
+
+template <typename Container, typename Function>
+void ParallelForEach(Container& container, Function fn, ThreadPool& pool = ThreadPool::Default()) {
+	auto* first = detail::ToAddress(container.begin());
+	detail::ForEachChunk(first, detail::ToAddress(container.end()) - first, pool, [&](size_t begin, size_t end) {
+		std::for_each(first + begin, first + end, fn);
+	});
+}
+
+template <typename Container, typename T>
+void ParallelFill(Container& container, const T& value, ThreadPool& pool = ThreadPool::Default()) {
+	auto* first = detail::ToAddress(container.begin());
+	detail::ForEachChunk(first, detail::ToAddress(container.end()) - first, pool, [&](size_t begin, size_t end) {
+		std::fill(first + begin, first + end, value);
+	});
+}
+
+// Writes op(src[i]) to dst[i]. dst must already hold as many elements as src;
+// chunks follow dst so the writes stay cache-line private.
+template <typename Source, typename Destination, typename UnaryOperation>
+void ParallelTransform(const Source& src, Destination& dst, UnaryOperation op, ThreadPool& pool = ThreadPool::Default()) {
+	const auto* in = detail::ToAddress(src.begin());
+	auto* out = detail::ToAddress(dst.begin());
+	assert(static_cast<size_t>(detail::ToAddress(src.end()) - in) == static_cast<size_t>(detail::ToAddress(dst.end()) - out));
+	detail::ForEachChunk(out, detail::ToAddress(dst.end()) - out, pool, [&](size_t begin, size_t end) {
+		std::transform(in + begin, in + end, out + begin, op);
+	});
+}
+
+// Folds the elements with op, which must be associative. Each chunk is
+// reduced on its own and the partial results are combined with init in
+// chunk order, so non-commutative operations give the sequential result.
+template <typename Container, typename U, typename BinaryOperation = std::plus<>>
+U ParallelReduce(const Container& container, U init, BinaryOperation op = BinaryOperation(),
+	ThreadPool& pool = ThreadPool::Default()) {
+	const auto* first = detail::ToAddress(container.begin());
+	size_t n = detail::ToAddress(container.end()) - first;
+	size_t chunks = detail::ChunkCount<std::remove_cv_t<std::remove_reference_t<decltype(*first)>>>(n, pool.Size());
+
+	Vector<std::optional<U>> partial(chunks);
+	pool.ParallelFor(chunks, [&](size_t i) {
+		size_t begin = detail::ChunkBoundary(first, n, chunks, i);
+		size_t end = detail::ChunkBoundary(first, n, chunks, i + 1);
+		if (begin < end) {
+			U acc = static_cast<U>(first[begin]);
+			for (size_t j = begin + 1; j < end; ++j) {
+				acc = op(std::move(acc), first[j]);
+			}
+			partial[i].emplace(std::move(acc));
+		}
+	});
+
+	for (std::optional<U>& value : partial) {
+		if (value) {
+			init = op(std::move(init), std::move(*value));
+		}
+	}
+	return init;
+}
+
+// Sorts the chunks in parallel and then merges neighbouring runs pairwise,
+// one parallel round per doubling of the run length.
+template <typename Container, typename Compare = std::less<>>
+void ParallelSort(Container& container, Compare comp = Compare(), ThreadPool& pool = ThreadPool::Default()) {
+	auto* first = detail::ToAddress(container.begin());
+	size_t n = detail::ToAddress(container.end()) - first;
+	size_t chunks = detail::ChunkCount<std::remove_reference_t<decltype(*first)>>(n, pool.Size());
+
+	Vector<size_t> bounds(chunks + 1);
+	for (size_t i = 0; i <= chunks; ++i) {
+		bounds[i] = detail::ChunkBoundary(first, n, chunks, i);
+	}
+
+	pool.ParallelFor(chunks, [&](size_t i) {
+		std::sort(first + bounds[i], first + bounds[i + 1], comp);
+	});
+
+	for (size_t width = 1; width < chunks; width *= 2) {
+		size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+		pool.ParallelFor(pairs, [&](size_t pair) {
+			size_t left = pair * 2 * width;
+			size_t mid = std::min(left + width, chunks);
+			size_t right = std::min(left + 2 * width, chunks);
+			if (mid < right) {
+				std::inplace_merge(first + bounds[left], first + bounds[mid], first + bounds[right], comp);
+			}
+		});
+	}
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include "vector.h"
+
+namespace detail {
+
+inline constexpr size_t kSegmentedChunkBytes = 64 * 1024;
+
+// Largest power of two number of elements that fits the chunk byte budget.
+template <typename T>
+constexpr size_t DefaultChunkSize() noexcept {
+	size_t size = 1;
+	while (size * 2 * sizeof(T) <= kSegmentedChunkBytes) {
+		size *= 2;
+	}
+	return size;
+}
+
+}
+
+// Vector made of fixed-size RawMemory chunks reached through a chunk index.
+// Growth allocates one more chunk and never relocates elements, so element
+// addresses stay valid until the element is erased, there is no capacity
+// doubling peak and no O(n) copy stall. Indexing costs one extra load for
+// the chunk pointer; ForEachChunk hands out the contiguous runs for bulk
+// processing. Only the small index of chunk headers is ever reallocated.
+template <typename T, typename Alloc = std::allocator<T>, size_t ChunkSize = detail::DefaultChunkSize<T>()>
+class SegmentedVector {
+	static_assert(ChunkSize != 0 && (ChunkSize & (ChunkSize - 1)) == 0, "ChunkSize must be a power of two");
+
+	using AllocTraits = std::allocator_traits<Alloc>;
+
+public:
+	using iterator = detail::IndexIterator<SegmentedVector, T>;
+	using const_iterator = detail::IndexIterator<const SegmentedVector, const T>;
+	using allocator_type = Alloc;
+
+	static constexpr size_t kChunkSize = ChunkSize;
+
+	SegmentedVector() noexcept(noexcept(Alloc())) = default;
+
+	explicit SegmentedVector(const Alloc& alloc) noexcept
+		: alloc_(alloc) {
+
+	}
+
+	SegmentedVector(size_t size, const Alloc& alloc = Alloc())
+		: SegmentedVector(alloc) {
+		Resize(size);
+	}
+
+	SegmentedVector(const SegmentedVector& other)
+		: SegmentedVector(other, AllocTraits::select_on_container_copy_construction(other.alloc_)) {
+
+	}
+
+	// Delegates to the allocator constructor, so the destructor cleans up if
+	// a copy throws.
+	SegmentedVector(const SegmentedVector& other, const Alloc& alloc)
+		: SegmentedVector(alloc) {
+		AppendFrom(other);
+	}
+
+	SegmentedVector(SegmentedVector&& other) noexcept
+		: chunks_(std::move(other.chunks_))
+		, size_(std::exchange(other.size_, 0))
+		, alloc_(other.alloc_) {
+
+	}
+
+	SegmentedVector& operator=(const SegmentedVector& rhs) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		Clear();
+		if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+			if (alloc_ != rhs.alloc_) {
+				chunks_.Clear();
+			}
+			alloc_ = rhs.alloc_;
+		}
+		AppendFrom(rhs);
+		return *this;
+	}
+
+	SegmentedVector& operator=(SegmentedVector&& rhs) noexcept(AllocTraits::propagate_on_container_move_assignment::value
+		|| AllocTraits::is_always_equal::value) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		Clear();
+		bool can_steal = true;
+		if constexpr (!AllocTraits::propagate_on_container_move_assignment::value
+			&& !AllocTraits::is_always_equal::value) {
+			can_steal = alloc_ == rhs.alloc_;
+		}
+
+		if (can_steal) {
+			chunks_ = std::move(rhs.chunks_);
+			size_ = std::exchange(rhs.size_, 0);
+			if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+				alloc_ = rhs.alloc_;
+			}
+		} else {
+			Reserve(rhs.Size());
+			rhs.ForEachChunk([this](T* first, size_t count) {
+				for (size_t i = 0; i < count; ++i) {
+					EmplaceBack(std::move(first[i]));
+				}
+			});
+			rhs.Clear();
+		}
+		return *this;
+	}
+
+	~SegmentedVector() {
+		Clear();
+	}
+
+	iterator begin() noexcept {
+		return iterator(this, 0);
+	}
+
+	iterator end() noexcept {
+		return iterator(this, Size());
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return const_iterator(this, 0);
+	}
+
+	const_iterator cend() const noexcept {
+		return const_iterator(this, Size());
+	}
+
+	// Shifts the tail element by element, as Vector does; O(n - pos).
+	template <typename... Args>
+	iterator Emplace(const_iterator position, Args&&... args) {
+		size_t pos = position.Index();
+		assert(pos <= Size());
+		if (pos == Size()) {
+			EmplaceBack(std::forward<Args>(args)...);
+			return begin() + pos;
+		}
+
+		T tmp_obj(std::forward<Args>(args)...);
+		EmplaceBack(std::move((*this)[Size() - 1]));
+		std::move_backward(begin() + pos, end() - 2, end() - 1);
+		(*this)[pos] = std::move(tmp_obj);
+		return begin() + pos;
+	}
+
+	iterator Insert(const_iterator position, const T& value) {
+		return Emplace(position, value);
+	}
+
+	iterator Insert(const_iterator position, T&& value) {
+		return Emplace(position, std::move(value));
+	}
+
+	iterator Erase(const_iterator position) {
+		size_t pos = position.Index();
+		assert(pos < Size());
+		std::move(begin() + pos + 1, end(), begin() + pos);
+		PopBack();
+		return begin() + pos;
+	}
+
+	iterator Erase(const_iterator first, const_iterator last) {
+		size_t pos = first.Index();
+		VECTOR_CHECK(pos <= last.Index(), "Erase range is reversed");
+		size_t count = last.Index() - pos;
+		VECTOR_CHECK(last.Index() <= Size(), "Erase range out of range");
+		std::move(begin() + pos + count, end(), begin() + pos);
+		DestroyFrom(Size() - count);
+		return begin() + pos;
+	}
+
+	template <typename... Args>
+	T& EmplaceBack(Args&&... args) {
+		if (Size() == Capacity()) {
+			chunks_.EmplaceBack(ChunkSize, alloc_);
+		}
+		T* slot = SlotAt(Size());
+		new (slot) T(std::forward<Args>(args)...);
+		++size_;
+		return *slot;
+	}
+
+	template <typename Type>
+	void PushBack(Type&& value) {
+		EmplaceBack(std::forward<Type>(value));
+	}
+
+	void PopBack() noexcept {
+		assert(size_ != 0);
+		std::destroy_at(SlotAt(Size() - 1));
+		--size_;
+	}
+
+	void Resize(size_t new_size) {
+		if (new_size < Size()) {
+			DestroyFrom(new_size);
+			return;
+		}
+		Reserve(new_size);
+		while (Size() < new_size) {
+			EmplaceBack();
+		}
+	}
+
+	// Allocates chunks up front; existing elements never move.
+	void Reserve(size_t capacity) {
+		size_t chunks = (capacity + ChunkSize - 1) / ChunkSize;
+		chunks_.Reserve(chunks);
+		while (chunks_.Size() < chunks) {
+			chunks_.EmplaceBack(ChunkSize, alloc_);
+		}
+	}
+
+	// Frees the chunks past the last element.
+	void ShrinkToFit() {
+		size_t chunks = (Size() + ChunkSize - 1) / ChunkSize;
+		while (chunks_.Size() > chunks) {
+			chunks_.PopBack();
+		}
+		chunks_.ShrinkToFit();
+	}
+
+	// Destroys all elements but keeps the chunks for reuse.
+	void Clear() noexcept {
+		DestroyFrom(0);
+	}
+
+	void Swap(SegmentedVector& other) noexcept {
+		if constexpr (AllocTraits::propagate_on_container_swap::value) {
+			using std::swap;
+			swap(alloc_, other.alloc_);
+		} else {
+			assert(alloc_ == other.alloc_);
+		}
+		chunks_.Swap(other.chunks_);
+		std::swap(size_, other.size_);
+	}
+
+	// Calls fn(first, count) for each contiguous run of elements, in order.
+	template <typename Function>
+	void ForEachChunk(Function fn) {
+		ForEachRun(*this, 0, Size(), fn);
+	}
+
+	template <typename Function>
+	void ForEachChunk(Function fn) const {
+		ForEachRun(*this, 0, Size(), fn);
+	}
+
+	size_t Size() const noexcept {
+		return size_;
+	}
+
+	size_t Capacity() const noexcept {
+		return chunks_.Size() * ChunkSize;
+	}
+
+	const Alloc& GetAllocator() const noexcept {
+		return alloc_;
+	}
+
+	const T& operator[](size_t index) const noexcept {
+		return const_cast<SegmentedVector&>(*this)[index];
+	}
+
+	T& operator[](size_t index) noexcept {
+		VECTOR_CHECK(index < size_, "SegmentedVector index out of range");
+		return *SlotAt(index);
+	}
+
+private:
+	T* SlotAt(size_t index) noexcept {
+		return chunks_[index / ChunkSize].GetAddress() + index % ChunkSize;
+	}
+
+	template <typename Self, typename Function>
+	static void ForEachRun(Self& self, size_t first, size_t last, Function& fn) {
+		while (first < last) {
+			size_t offset = first % ChunkSize;
+			size_t count = std::min(ChunkSize - offset, last - first);
+			fn(self.chunks_[first / ChunkSize].GetAddress() + offset, count);
+			first += count;
+		}
+	}
+
+	void AppendFrom(const SegmentedVector& other) {
+		Reserve(Size() + other.Size());
+		other.ForEachChunk([this](const T* first, size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				EmplaceBack(first[i]);
+			}
+		});
+	}
+
+	void DestroyFrom(size_t new_size) noexcept {
+		auto destroy = [](T* first, size_t count) {
+			std::destroy_n(first, count);
+		};
+		ForEachRun(*this, new_size, Size(), destroy);
+		size_ = new_size;
+	}
+
+	// Chunk headers only; the index is metadata and uses the default
+	// allocator, each chunk remembers the allocator of its elements.
+	Vector<RawMemory<T, Alloc>> chunks_;
+	size_t size_ = 0;
+	[[no_unique_address]] Alloc alloc_ = Alloc();
+
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "vector.h"
+
+#include <atomic>
+#include <mutex>
+
+// Immutable Vector shared between handles through an atomic reference count.
+// Copying a SharedVector copies a pointer; the elements are copied only when
+// a handle that shares them asks for Mutable(), so read-mostly tables can be
+// handed to every worker without duplicating them.
+//
+// A single handle is no more thread-safe than a shared_ptr: distinct handles
+// to the same elements may be used from any threads, one handle may not be
+// mutated while another thread reads it. SharedVectorCell is the point where
+// a writer hands new versions to concurrent readers.
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowthPolicy,
+	typename Stats = NoVectorStats>
+class SharedVector {
+public:
+	using VectorType = Vector<T, Alloc, Growth, Stats>;
+	using const_iterator = typename VectorType::const_iterator;
+
+	SharedVector() = default;
+
+	explicit SharedVector(VectorType&& vector)
+		: data_(std::make_shared<VectorType>(std::move(vector))) {
+
+	}
+
+	const_iterator begin() const noexcept {
+		return Get().begin();
+	}
+
+	const_iterator end() const noexcept {
+		return Get().end();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return Get().cbegin();
+	}
+
+	const_iterator cend() const noexcept {
+		return Get().cend();
+	}
+
+	const T* Data() const noexcept {
+		return Get().Data();
+	}
+
+	size_t Size() const noexcept {
+		return data_ ? data_->Size() : 0;
+	}
+
+	const T& operator[](size_t index) const noexcept {
+		return Get()[index];
+	}
+
+	const VectorType& Get() const noexcept {
+		return data_ ? *data_ : Empty();
+	}
+
+	// Number of handles sharing the elements, for diagnostics only: other
+	// threads may change it at any time.
+	long UseCount() const noexcept {
+		return data_.use_count();
+	}
+
+	// Copy-on-write access. Copies the elements into a buffer owned by this
+	// handle alone unless it already is the only one; the returned reference
+	// stays valid until the handle is copied, assigned or destroyed.
+	VectorType& Mutable() {
+		if (!data_) {
+			data_ = std::make_shared<VectorType>();
+		} else if (!IsUnique()) {
+			data_ = std::make_shared<VectorType>(*data_);
+		}
+		return *data_;
+	}
+
+	// Turns the handle back into a plain Vector, moving the elements out when
+	// no other handle shares them and copying them otherwise.
+	VectorType Thaw() && {
+		if (!data_) {
+			return VectorType();
+		}
+		VectorType result = IsUnique() ? std::move(*data_) : VectorType(*data_);
+		data_.reset();
+		return result;
+	}
+
+	void Swap(SharedVector& other) noexcept {
+		data_.swap(other.data_);
+	}
+
+private:
+	// use_count is a relaxed load. The acquire fence pairs with the release
+	// decrement of the last other owner, so its reads of the elements
+	// happen before our writes.
+	bool IsUnique() const noexcept {
+		if (data_.use_count() != 1) {
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return true;
+	}
+
+	static const VectorType& Empty() noexcept {
+		static const VectorType empty;
+		return empty;
+	}
+
+	std::shared_ptr<VectorType> data_;
+
+};
+
+template <typename T, typename Alloc, typename Growth, typename Stats>
+SharedVector<T, Alloc, Growth, Stats> Freeze(Vector<T, Alloc, Growth, Stats>&& vector) {
+	return SharedVector<T, Alloc, Growth, Stats>(std::move(vector));
+}
+
+// Latest published version of a SharedVector. Readers take a Snapshot, which
+// is one short critical section plus a reference count increment, and keep
+// working on it however many versions are published after it. A writer
+// builds the next version privately, typically from
+// Snapshot().Mutable(), and Publishes it; the old version is freed when its
+// last reader lets go.
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowthPolicy,
+	typename Stats = NoVectorStats>
+class SharedVectorCell {
+public:
+	using SharedType = SharedVector<T, Alloc, Growth, Stats>;
+	using VectorType = typename SharedType::VectorType;
+
+	SharedVectorCell() = default;
+
+	explicit SharedVectorCell(SharedType initial)
+		: current_(std::move(initial)) {
+
+	}
+
+	SharedVectorCell(const SharedVectorCell&) = delete;
+
+	SharedVectorCell& operator=(const SharedVectorCell&) = delete;
+
+	SharedType Snapshot() const {
+		std::lock_guard lock(mutex_);
+		return current_;
+	}
+
+	void Publish(SharedType next) {
+		{
+			std::lock_guard lock(mutex_);
+			current_.Swap(next);
+			version_.fetch_add(1, std::memory_order_release);
+		}
+		// next now holds the previous version, released outside the lock.
+	}
+
+	void Publish(VectorType&& next) {
+		Publish(SharedType(std::move(next)));
+	}
+
+	// Incremented by every Publish, so readers can check cheaply whether
+	// their snapshot is still current.
+	uint64_t Version() const noexcept {
+		return version_.load(std::memory_order_acquire);
+	}
+
+private:
+	mutable std::mutex mutex_;
+	SharedType current_;
+	std::atomic<uint64_t> version_{0};
+
+};
@@ -0,0 +1,419 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+// Vectorized scans over contiguous containers of arithmetic elements: Find,
+// IndexOf, Count, Contains, MinMax and Sum. The kernels are written once
+// with GCC/Clang vector extensions and compiled for AVX-512, AVX2 and NEON.
+// On x86 the widest level the CPU supports is picked at run time. Other
+// element types, other compilers and short tails use scalar code.
+//
+// Floating-point Sum adds lanes in a different order than a sequential loop,
+// so the last bits can differ. MinMax is unspecified in the presence of NaN.
+
+enum class SimdLevel {
+	kScalar,
+	kNeon,
+	kAvx2,
+	kAvx512,
+};
+
+inline constexpr size_t kNotFound = std::numeric_limits<size_t>::max();
+
+template <typename T>
+using SumType = std::conditional_t<std::is_floating_point_v<T>, T,
+	std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+namespace detail {
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VECTOR_SIMD_X86 1
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define VECTOR_SIMD_NEON 1
+#endif
+
+template <typename T>
+inline constexpr bool IsSimdElementV = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>
+	&& !std::is_same_v<T, long double>;
+
+inline SimdLevel DetectSimdLevel() noexcept {
+#if defined(VECTOR_SIMD_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+		return SimdLevel::kAvx512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return SimdLevel::kAvx2;
+	}
+	return SimdLevel::kScalar;
+#elif defined(VECTOR_SIMD_NEON)
+	return SimdLevel::kNeon;
+#else
+	return SimdLevel::kScalar;
+#endif
+}
+
+#if defined(VECTOR_SIMD_X86) || defined(VECTOR_SIMD_NEON)
+
+// Kernels for one vector width. They keep vectors in local variables only,
+// never in parameters or return values, so they can be inlined into
+// functions compiled for a wider target without ABI trouble.
+template <typename T, size_t Bytes>
+struct SimdKernels {
+	static constexpr size_t kLanes = Bytes / sizeof(T);
+
+	typedef T Vec __attribute__((vector_size(Bytes)));
+	typedef SumType<T> Wide __attribute__((vector_size(Bytes / sizeof(T) * sizeof(SumType<T>))));
+
+	__attribute__((always_inline)) static inline size_t IndexOf(const T* p, size_t n, T value) noexcept {
+		Vec needle = Vec{} + value;
+		size_t i = 0;
+		for (; i + kLanes <= n; i += kLanes) {
+			Vec block;
+			std::memcpy(&block, p + i, Bytes);
+			auto mask = block == needle;
+			uint64_t bits[Bytes / 8];
+			std::memcpy(bits, &mask, Bytes);
+			uint64_t any = 0;
+			for (uint64_t word : bits) {
+				any |= word;
+			}
+			if (any != 0) {
+				break;
+			}
+		}
+		for (; i < n; ++i) {
+			if (p[i] == value) {
+				return i;
+			}
+		}
+		return kNotFound;
+	}
+
+	__attribute__((always_inline)) static inline size_t Count(const T* p, size_t n, T value) noexcept {
+		// Comparison yields -1 per matching lane, in a signed integer of the
+		// element's width; the per-lane counters are drained before they wrap.
+		using Lane = decltype(Vec{} == Vec{});
+		using LaneScalar = std::conditional_t<sizeof(T) == 1, int8_t, std::conditional_t<sizeof(T) == 2, int16_t,
+			std::conditional_t<sizeof(T) == 4, int32_t, int64_t>>>;
+		constexpr size_t kFlushBlocks = size_t(std::numeric_limits<LaneScalar>::max()) / 2;
+
+		Vec needle = Vec{} + value;
+		size_t count = 0;
+		size_t i = 0;
+		while (i + kLanes <= n) {
+			Lane counts{};
+			for (size_t blocks = 0; blocks < kFlushBlocks && i + kLanes <= n; ++blocks, i += kLanes) {
+				Vec block;
+				std::memcpy(&block, p + i, Bytes);
+				counts -= block == needle;
+			}
+			for (size_t lane = 0; lane < kLanes; ++lane) {
+				count += static_cast<size_t>(counts[lane]);
+			}
+		}
+		for (; i < n; ++i) {
+			count += p[i] == value;
+		}
+		return count;
+	}
+
+	__attribute__((always_inline)) static inline void MinMax(const T* p, size_t n, T& min, T& max) noexcept {
+		size_t i = 0;
+		if (n >= kLanes) {
+			Vec lo;
+			std::memcpy(&lo, p, Bytes);
+			Vec hi = lo;
+			for (i = kLanes; i + kLanes <= n; i += kLanes) {
+				Vec block;
+				std::memcpy(&block, p + i, Bytes);
+				lo = block < lo ? block : lo;
+				hi = block > hi ? block : hi;
+			}
+			min = lo[0];
+			max = hi[0];
+			for (size_t lane = 1; lane < kLanes; ++lane) {
+				min = std::min<T>(min, lo[lane]);
+				max = std::max<T>(max, hi[lane]);
+			}
+		} else {
+			min = max = p[i++];
+		}
+		for (; i < n; ++i) {
+			min = std::min<T>(min, p[i]);
+			max = std::max<T>(max, p[i]);
+		}
+	}
+
+	__attribute__((always_inline)) static inline SumType<T> Sum(const T* p, size_t n) noexcept {
+		Wide acc{};
+		size_t i = 0;
+		for (; i + kLanes <= n; i += kLanes) {
+			Vec block;
+			std::memcpy(&block, p + i, Bytes);
+			acc += __builtin_convertvector(block, Wide);
+		}
+		SumType<T> sum{};
+		for (size_t lane = 0; lane < kLanes; ++lane) {
+			sum += acc[lane];
+		}
+		for (; i < n; ++i) {
+			sum += p[i];
+		}
+		return sum;
+	}
+};
+
+#endif
+
+#if defined(VECTOR_SIMD_X86)
+#define VECTOR_SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define VECTOR_SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX512 size_t IndexOfAvx512(const T* p, size_t n, T value) noexcept {
+	return SimdKernels<T, 64>::IndexOf(p, n, value);
+}
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX2 size_t IndexOfAvx2(const T* p, size_t n, T value) noexcept {
+	return SimdKernels<T, 32>::IndexOf(p, n, value);
+}
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX512 size_t CountAvx512(const T* p, size_t n, T value) noexcept {
+	return SimdKernels<T, 64>::Count(p, n, value);
+}
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX2 size_t CountAvx2(const T* p, size_t n, T value) noexcept {
+	return SimdKernels<T, 32>::Count(p, n, value);
+}
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX512 void MinMaxAvx512(const T* p, size_t n, T& min, T& max) noexcept {
+	SimdKernels<T, 64>::MinMax(p, n, min, max);
+}
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX2 void MinMaxAvx2(const T* p, size_t n, T& min, T& max) noexcept {
+	SimdKernels<T, 32>::MinMax(p, n, min, max);
+}
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX512 SumType<T> SumAvx512(const T* p, size_t n) noexcept {
+	return SimdKernels<T, 64>::Sum(p, n);
+}
+
+template <typename T>
+VECTOR_SIMD_TARGET_AVX2 SumType<T> SumAvx2(const T* p, size_t n) noexcept {
+	return SimdKernels<T, 32>::Sum(p, n);
+}
+
+#undef VECTOR_SIMD_TARGET_AVX2
+#undef VECTOR_SIMD_TARGET_AVX512
+#endif
+
+}
+
+inline SimdLevel ActiveSimdLevel() noexcept {
+	static const SimdLevel level = detail::DetectSimdLevel();
+	return level;
+}
+
+// Index of the first element equal to value, or kNotFound.
+template <typename T>
+size_t IndexOf(const T* p, size_t n, const T& value) noexcept {
+	if constexpr (detail::IsSimdElementV<T>) {
+#if defined(VECTOR_SIMD_X86)
+		switch (ActiveSimdLevel()) {
+		case SimdLevel::kAvx512:
+			return detail::IndexOfAvx512(p, n, value);
+		case SimdLevel::kAvx2:
+			return detail::IndexOfAvx2(p, n, value);
+		default:
+			break;
+		}
+#elif defined(VECTOR_SIMD_NEON)
+		return detail::SimdKernels<T, 16>::IndexOf(p, n, value);
+#endif
+	}
+	const T* found = std::find(p, p + n, value);
+	return found != p + n ? static_cast<size_t>(found - p) : kNotFound;
+}
+
+template <typename T>
+size_t Count(const T* p, size_t n, const T& value) noexcept {
+	if constexpr (detail::IsSimdElementV<T>) {
+#if defined(VECTOR_SIMD_X86)
+		switch (ActiveSimdLevel()) {
+		case SimdLevel::kAvx512:
+			return detail::CountAvx512(p, n, value);
+		case SimdLevel::kAvx2:
+			return detail::CountAvx2(p, n, value);
+		default:
+			break;
+		}
+#elif defined(VECTOR_SIMD_NEON)
+		return detail::SimdKernels<T, 16>::Count(p, n, value);
+#endif
+	}
+	return std::count(p, p + n, value);
+}
+
+// Smallest and largest element of a non-empty range.
+template <typename T>
+std::pair<T, T> MinMax(const T* p, size_t n) noexcept {
+	assert(n != 0);
+	if constexpr (detail::IsSimdElementV<T>) {
+		T min{};
+		T max{};
+#if defined(VECTOR_SIMD_X86)
+		switch (ActiveSimdLevel()) {
+		case SimdLevel::kAvx512:
+			detail::MinMaxAvx512(p, n, min, max);
+			return {min, max};
+		case SimdLevel::kAvx2:
+			detail::MinMaxAvx2(p, n, min, max);
+			return {min, max};
+		default:
+			break;
+		}
+#elif defined(VECTOR_SIMD_NEON)
+		detail::SimdKernels<T, 16>::MinMax(p, n, min, max);
+		return {min, max};
+#endif
+	}
+	auto [min, max] = std::minmax_element(p, p + n);
+	return {*min, *max};
+}
+
+// Sum of the elements, accumulated in 64 bits for integers.
+template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+SumType<T> Sum(const T* p, size_t n) noexcept {
+	if constexpr (detail::IsSimdElementV<T>) {
+#if defined(VECTOR_SIMD_X86)
+		switch (ActiveSimdLevel()) {
+		case SimdLevel::kAvx512:
+			return detail::SumAvx512(p, n);
+		case SimdLevel::kAvx2:
+			return detail::SumAvx2(p, n);
+		default:
+			break;
+		}
+#elif defined(VECTOR_SIMD_NEON)
+		return detail::SimdKernels<T, 16>::Sum(p, n);
+#endif
+	}
+	SumType<T> sum{};
+	for (size_t i = 0; i < n; ++i) {
+		sum += p[i];
+	}
+	return sum;
+}
+
+namespace detail {
+
+// Search values of another arithmetic type of the same kind, typically
+// literals, are converted to the element type so they reach the kernels.
+template <typename Element, typename T>
+inline constexpr bool IsConvertibleSearchV = IsSimdElementV<Element> && IsSimdElementV<T>
+	&& std::is_integral_v<Element> == std::is_integral_v<T>;
+
+// Stores value as an Element and returns true when Element represents it
+// exactly. Otherwise no element compares equal to it and nothing is stored.
+template <typename Element, typename T>
+constexpr bool ConvertSearchValue(T value, Element& out) noexcept {
+	using Limits = std::numeric_limits<Element>;
+	if constexpr (std::is_integral_v<T>) {
+		if constexpr (std::is_signed_v<T> && !std::is_signed_v<Element>) {
+			if (value < 0 || static_cast<std::make_unsigned_t<T>>(value) > Limits::max()) {
+				return false;
+			}
+		} else if constexpr (!std::is_signed_v<T> && std::is_signed_v<Element>) {
+			if (value > static_cast<std::make_unsigned_t<Element>>(Limits::max())) {
+				return false;
+			}
+		} else if (value < Limits::min() || value > Limits::max()) {
+			return false;
+		}
+		out = static_cast<Element>(value);
+		return true;
+	} else {
+		constexpr T kInfinity = std::numeric_limits<T>::infinity();
+		if (value != kInfinity && value != -kInfinity && (value > Limits::max() || value < Limits::lowest())) {
+			return false;
+		}
+		Element converted = static_cast<Element>(value);
+		if (static_cast<T>(converted) != value) {
+			return false;
+		}
+		out = converted;
+		return true;
+	}
+}
+
+}
+
+template <typename Container, typename T>
+size_t IndexOf(const Container& container, const T& value) noexcept {
+	const auto* first = detail::ToAddress(container.begin());
+	using Element = std::remove_cv_t<std::remove_reference_t<decltype(*first)>>;
+	if constexpr (std::is_same_v<Element, T>) {
+		return IndexOf(first, detail::ToAddress(container.end()) - first, value);
+	} else if constexpr (detail::IsConvertibleSearchV<Element, T>) {
+		Element needle{};
+		if (!detail::ConvertSearchValue(value, needle)) {
+			return kNotFound;
+		}
+		return IndexOf(first, detail::ToAddress(container.end()) - first, needle);
+	} else {
+		const auto* last = detail::ToAddress(container.end());
+		const auto* found = std::find(first, last, value);
+		return found != last ? static_cast<size_t>(found - first) : kNotFound;
+	}
+}
+
+template <typename Container, typename T>
+auto Find(Container& container, const T& value) noexcept -> decltype(container.begin()) {
+	size_t index = IndexOf(container, value);
+	return index != kNotFound ? container.begin() + index : container.end();
+}
+
+template <typename Container, typename T>
+bool Contains(const Container& container, const T& value) noexcept {
+	return IndexOf(container, value) != kNotFound;
+}
+
+template <typename Container, typename T>
+size_t Count(const Container& container, const T& value) noexcept {
+	const auto* first = detail::ToAddress(container.begin());
+	using Element = std::remove_cv_t<std::remove_reference_t<decltype(*first)>>;
+	if constexpr (std::is_same_v<Element, T>) {
+		return Count(first, detail::ToAddress(container.end()) - first, value);
+	} else if constexpr (detail::IsConvertibleSearchV<Element, T>) {
+		Element needle{};
+		if (!detail::ConvertSearchValue(value, needle)) {
+			return 0;
+		}
+		return Count(first, detail::ToAddress(container.end()) - first, needle);
+	} else {
+		return std::count(first, detail::ToAddress(container.end()), value);
+	}
+}
+
+template <typename Container>
+auto MinMax(const Container& container) noexcept {
+	const auto* first = detail::ToAddress(container.begin());
+	return MinMax(first, detail::ToAddress(container.end()) - first);
+}
+
+template <typename Container>
+auto Sum(const Container& container) noexcept {
+	const auto* first = detail::ToAddress(container.begin());
+	return Sum(first, detail::ToAddress(container.end()) - first);
+}
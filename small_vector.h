@@ -0,0 +1,290 @@
+#pragma once
+
+#include "vector.h"
+
+// Vector with inline storage for N elements. The first N elements live inside
+// the object itself; only growing past N allocates a RawMemory buffer.
+template <typename T, size_t N, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowthPolicy>
+class SmallVector {
+	static_assert(N > 0, "SmallVector needs at least one inline element");
+
+	using AllocTraits = std::allocator_traits<Alloc>;
+
+public:
+	using iterator = T*;
+	using const_iterator = const T*;
+	using allocator_type = Alloc;
+
+	static constexpr size_t kInlineCapacity = N;
+
+	SmallVector() noexcept(noexcept(Alloc()))
+		: heap_(RawMemory<T, Alloc>()), size_(0) {
+
+	}
+
+	explicit SmallVector(const Alloc& alloc) noexcept
+		: heap_(RawMemory<T, Alloc>(alloc)), size_(0) {
+
+	}
+
+	SmallVector(size_t size, const Alloc& alloc = Alloc())
+		: heap_(RawMemory<T, Alloc>(alloc)), size_(0) {
+		Reserve(size);
+		std::uninitialized_value_construct_n(Data(), size);
+		size_ = size;
+	}
+
+	SmallVector(const SmallVector& other)
+		: SmallVector(other, AllocTraits::select_on_container_copy_construction(other.GetAllocator())) {
+
+	}
+
+	SmallVector(const SmallVector& other, const Alloc& alloc)
+		: heap_(RawMemory<T, Alloc>(alloc)), size_(0) {
+		Reserve(other.Size());
+		std::uninitialized_copy_n(other.Data(), other.Size(), Data());
+		size_ = other.Size();
+	}
+
+	SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+		: heap_(RawMemory<T, Alloc>(other.GetAllocator())), size_(0) {
+		MoveFrom(other);
+	}
+
+	SmallVector& operator=(const SmallVector& rhs) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+			if (GetAllocator() != rhs.GetAllocator()) {
+				Clear();
+				heap_.Reset(rhs.GetAllocator());
+			} else {
+				heap_.SetAllocator(rhs.GetAllocator());
+			}
+		}
+
+		if (rhs.Size() > Capacity()) {
+			SmallVector rhs_copy(rhs, GetAllocator());
+			Swap(rhs_copy);
+			return *this;
+		}
+
+		if (rhs.Size() < Size()) {
+			std::copy_n(rhs.Data(), rhs.Size(), Data());
+			std::destroy_n(Data() + rhs.Size(), Size() - rhs.Size());
+		} else {
+			std::copy_n(rhs.Data(), Size(), Data());
+			std::uninitialized_copy_n(rhs.Data() + Size(), rhs.Size() - Size(), Data() + Size());
+		}
+
+		size_ = rhs.size_;
+		return *this;
+	}
+
+	SmallVector& operator=(SmallVector&& rhs) noexcept(std::is_nothrow_move_constructible_v<T>
+		&& (AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value)) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		Clear();
+		MoveFrom(rhs);
+		return *this;
+	}
+
+	~SmallVector() {
+		std::destroy_n(Data(), Size());
+	}
+
+	iterator begin() noexcept {
+		return Data();
+	}
+
+	iterator end() noexcept {
+		return Data() + Size();
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return Data();
+	}
+
+	const_iterator cend() const noexcept {
+		return Data() + Size();
+	}
+
+	template <typename... Args>
+	iterator Emplace(const_iterator position, Args&&... args) {
+		size_t pos = position - begin();
+
+		if (Capacity() > Size()) {
+			detail::EmplaceShift(Data(), size_, pos, std::forward<Args>(args)...);
+		} else {
+			RawMemory<T, Alloc> new_data(NextCapacity(Size() + 1), GetAllocator());
+			new (new_data.GetAddress() + pos) T(std::forward<Args>(args)...);
+			detail::RelocateAroundN(Data(), Size(), pos, new_data.GetAddress());
+			heap_.Swap(new_data);
+			size_++;
+		}
+		return begin() + pos;
+	}
+
+	iterator Erase(const_iterator position) {
+		size_t pos = position - begin();
+		detail::EraseShiftN(Data(), Size(), pos, 1);
+		size_--;
+		return begin() + pos;
+	}
+
+	iterator Insert(const_iterator position, const T& value) {
+		return Emplace(position, value);
+	}
+
+	iterator Insert(const_iterator position, T&& value) {
+		return Emplace(position, std::move(value));
+	}
+
+	void Resize(size_t new_size) {
+		if (new_size == Size()) {
+			return;
+		} else if (new_size < Size()) {
+			std::destroy_n(Data() + new_size, Size() - new_size);
+		} else {
+			Reserve(new_size);
+			std::uninitialized_value_construct_n(Data() + Size(), new_size - Size());
+		}
+		size_ = new_size;
+	}
+
+	template <typename Type>
+	void PushBack(Type&& value) {
+		EmplaceBack(std::forward<Type>(value));
+	}
+
+	void PopBack() {
+		std::destroy_at(Data() + Size() - 1);
+		size_--;
+	}
+
+	void Clear() noexcept {
+		std::destroy_n(Data(), Size());
+		size_ = 0;
+	}
+
+	void Swap(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_swappable_v<T>) {
+		if (!IsInline() && !other.IsInline()) {
+			heap_.Swap(other.heap_);
+		} else if (IsInline() && other.IsInline()) {
+			SmallVector& shorter = Size() < other.Size() ? *this : other;
+			SmallVector& longer = Size() < other.Size() ? other : *this;
+			std::swap_ranges(shorter.Data(), shorter.Data() + shorter.Size(), longer.Data());
+			detail::UninitializedRelocateN(longer.Data() + shorter.Size(), longer.Size() - shorter.Size(),
+				shorter.Data() + shorter.Size());
+			heap_.Swap(other.heap_);
+		} else {
+			SmallVector& on_heap = IsInline() ? other : *this;
+			SmallVector& in_place = IsInline() ? *this : other;
+			detail::UninitializedRelocateN(in_place.InlineData(), in_place.Size(), on_heap.InlineData());
+			on_heap.heap_.Swap(in_place.heap_);
+		}
+		std::swap(size_, other.size_);
+	}
+
+	void Reserve(size_t capacity) {
+		if (Capacity() >= capacity) {
+			return;
+		}
+
+		RawMemory<T, Alloc> new_data(capacity, GetAllocator());
+		detail::UninitializedRelocateN(Data(), Size(), new_data.GetAddress());
+		heap_.Swap(new_data);
+	}
+
+	size_t Size() const noexcept {
+		return size_;
+	}
+
+	size_t Capacity() const noexcept {
+		return IsInline() ? N : heap_.Capacity();
+	}
+
+	bool IsInline() const noexcept {
+		return heap_.GetAddress() == nullptr;
+	}
+
+	const Alloc& GetAllocator() const noexcept {
+		return heap_.GetAllocator();
+	}
+
+	template <typename... Args>
+	T& EmplaceBack(Args&&... args) {
+		if (Capacity() > Size()) {
+			new (Data() + Size()) T(std::forward<Args>(args)...);
+		} else {
+			RawMemory<T, Alloc> new_data(NextCapacity(Size() + 1), GetAllocator());
+			new (new_data.GetAddress() + Size()) T(std::forward<Args>(args)...);
+			detail::RelocateAroundN(Data(), Size(), Size(), new_data.GetAddress());
+			heap_.Swap(new_data);
+		}
+		return Data()[size_++];
+	}
+
+	const T& operator[](size_t index) const noexcept {
+		return const_cast<SmallVector&>(*this)[index];
+	}
+
+	T& operator[](size_t index) noexcept {
+		assert(index < size_);
+		return Data()[index];
+	}
+
+private:
+	T* InlineData() noexcept {
+		return std::launder(reinterpret_cast<T*>(inline_));
+	}
+
+	T* Data() noexcept {
+		return IsInline() ? InlineData() : heap_.GetAddress();
+	}
+
+	const T* Data() const noexcept {
+		return const_cast<SmallVector&>(*this).Data();
+	}
+
+	size_t NextCapacity(size_t required) const noexcept {
+		return Growth::template NextCapacity<T>(Capacity(), required);
+	}
+
+	// Takes the elements of other, which must be empty afterwards; requires
+	// this to hold no elements. Heap buffers are stolen when the allocators
+	// allow it, inline elements are relocated one by one.
+	void MoveFrom(SmallVector& other) {
+		bool can_steal = !other.IsInline();
+		if constexpr (!AllocTraits::propagate_on_container_move_assignment::value
+			&& !AllocTraits::is_always_equal::value) {
+			can_steal = can_steal && GetAllocator() == other.GetAllocator();
+		}
+
+		if (can_steal) {
+			heap_ = std::move(other.heap_);
+		} else {
+			Reserve(other.Size());
+			detail::UninitializedRelocateN(other.Data(), other.Size(), Data());
+		}
+		size_ = std::exchange(other.size_, 0);
+	}
+
+	alignas(T) unsigned char inline_[sizeof(T) * N];
+	RawMemory<T, Alloc> heap_;
+	size_t size_ = 0;
+
+};
@@ -0,0 +1,502 @@
+#pragma once
+
+#include "vector.h"
+
+#include <tuple>
+
+// Contiguous view of one column of an SoAVector. Works with the free
+// algorithms that take containers, e.g. Sum(particles.Column<2>()).
+template <typename T>
+class ColumnSpan {
+public:
+	ColumnSpan(T* data, size_t size) noexcept
+		: data_(data), size_(size) {
+
+	}
+
+	T* begin() const noexcept {
+		return data_;
+	}
+
+	T* end() const noexcept {
+		return data_ + size_;
+	}
+
+	T* Data() const noexcept {
+		return data_;
+	}
+
+	size_t Size() const noexcept {
+		return size_;
+	}
+
+	T& operator[](size_t index) const noexcept {
+		assert(index < size_);
+		return data_[index];
+	}
+
+private:
+	T* data_;
+	size_t size_;
+};
+
+// Structure-of-arrays vector: row i is (Column<0>()[i], Column<1>()[i], ...).
+// All columns share one RawMemory block, each starting on a cache line, so
+// they grow together with a single allocation. Row access goes through
+// proxy references, std::tuple<Fields&...>, so row-oriented code keeps
+// working while kernels can stream over a single column.
+template <typename... Fields>
+class SoAVector {
+	static_assert(sizeof...(Fields) > 0, "SoAVector needs at least one column");
+
+	static constexpr size_t kColumns = sizeof...(Fields);
+
+	template <size_t I>
+	using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+	template <size_t I>
+	using ColumnIndex = std::integral_constant<size_t, I>;
+
+	struct alignas(kCacheLineSize) Block {
+		unsigned char bytes[kCacheLineSize];
+	};
+
+	using Columns = std::tuple<Fields*...>;
+
+public:
+	using value_type = std::tuple<Fields...>;
+	using reference = std::tuple<Fields&...>;
+	using const_reference = std::tuple<const Fields&...>;
+
+	template <bool Const>
+	class Iterator {
+		using Owner = std::conditional_t<Const, const SoAVector, SoAVector>;
+
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = SoAVector::value_type;
+		using difference_type = ptrdiff_t;
+		using reference = std::conditional_t<Const, SoAVector::const_reference, SoAVector::reference>;
+		using pointer = void;
+
+		Iterator() noexcept = default;
+
+		Iterator(Owner* owner, size_t index) noexcept
+			: owner_(owner), index_(index) {
+
+		}
+
+		operator Iterator<true>() const noexcept {
+			return Iterator<true>(owner_, index_);
+		}
+
+		reference operator*() const noexcept {
+			return (*owner_)[index_];
+		}
+
+		reference operator[](difference_type offset) const noexcept {
+			return (*owner_)[index_ + offset];
+		}
+
+		size_t Index() const noexcept {
+			return index_;
+		}
+
+		Iterator& operator++() noexcept {
+			++index_;
+			return *this;
+		}
+
+		Iterator operator++(int) noexcept {
+			return Iterator(owner_, index_++);
+		}
+
+		Iterator& operator--() noexcept {
+			--index_;
+			return *this;
+		}
+
+		Iterator operator--(int) noexcept {
+			return Iterator(owner_, index_--);
+		}
+
+		Iterator& operator+=(difference_type offset) noexcept {
+			index_ += offset;
+			return *this;
+		}
+
+		Iterator& operator-=(difference_type offset) noexcept {
+			index_ -= offset;
+			return *this;
+		}
+
+		friend Iterator operator+(Iterator it, difference_type offset) noexcept {
+			return it += offset;
+		}
+
+		friend Iterator operator+(difference_type offset, Iterator it) noexcept {
+			return it += offset;
+		}
+
+		friend Iterator operator-(Iterator it, difference_type offset) noexcept {
+			return it -= offset;
+		}
+
+		friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return static_cast<difference_type>(lhs.index_) - static_cast<difference_type>(rhs.index_);
+		}
+
+		friend bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.index_ == rhs.index_;
+		}
+
+		friend bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.index_ != rhs.index_;
+		}
+
+		friend bool operator<(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.index_ < rhs.index_;
+		}
+
+		friend bool operator>(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.index_ > rhs.index_;
+		}
+
+		friend bool operator<=(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.index_ <= rhs.index_;
+		}
+
+		friend bool operator>=(const Iterator& lhs, const Iterator& rhs) noexcept {
+			return lhs.index_ >= rhs.index_;
+		}
+
+	private:
+		Owner* owner_ = nullptr;
+		size_t index_ = 0;
+	};
+
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+	SoAVector() noexcept = default;
+
+	explicit SoAVector(size_t size) {
+		Resize(size);
+	}
+
+	SoAVector(const SoAVector& other) {
+		Reserve(other.Size());
+		BuildColumns<0>([&](auto column) {
+			std::uninitialized_copy_n(other.template ColumnData<column>(), other.Size(), ColumnData<column>());
+		}, [&](auto column) {
+			std::destroy_n(ColumnData<column>(), other.Size());
+		});
+		size_ = other.Size();
+	}
+
+	SoAVector(SoAVector&& other) noexcept
+		: data_(std::move(other.data_))
+		, columns_(std::exchange(other.columns_, Columns()))
+		, capacity_(std::exchange(other.capacity_, 0))
+		, size_(std::exchange(other.size_, 0)) {
+
+	}
+
+	SoAVector& operator=(const SoAVector& rhs) {
+		if (this != &rhs) {
+			SoAVector rhs_copy(rhs);
+			Swap(rhs_copy);
+		}
+		return *this;
+	}
+
+	SoAVector& operator=(SoAVector&& rhs) noexcept {
+		if (this != &rhs) {
+			SoAVector rhs_moved(std::move(rhs));
+			Swap(rhs_moved);
+		}
+		return *this;
+	}
+
+	~SoAVector() {
+		DestroyRows(0, size_);
+	}
+
+	iterator begin() noexcept {
+		return iterator(this, 0);
+	}
+
+	iterator end() noexcept {
+		return iterator(this, size_);
+	}
+
+	const_iterator begin() const noexcept {
+		return cbegin();
+	}
+
+	const_iterator end() const noexcept {
+		return cend();
+	}
+
+	const_iterator cbegin() const noexcept {
+		return const_iterator(this, 0);
+	}
+
+	const_iterator cend() const noexcept {
+		return const_iterator(this, size_);
+	}
+
+	template <size_t I>
+	ColumnSpan<Field<I>> Column() noexcept {
+		return ColumnSpan<Field<I>>(ColumnData<I>(), size_);
+	}
+
+	template <size_t I>
+	ColumnSpan<const Field<I>> Column() const noexcept {
+		return ColumnSpan<const Field<I>>(ColumnData<I>(), size_);
+	}
+
+	template <size_t I>
+	Field<I>* ColumnData() noexcept {
+		return std::get<I>(columns_);
+	}
+
+	template <size_t I>
+	const Field<I>* ColumnData() const noexcept {
+		return std::get<I>(columns_);
+	}
+
+	// Appends a row; the i-th argument constructs the element of column i.
+	template <typename... Args>
+	reference EmplaceBack(Args&&... args) {
+		static_assert(sizeof...(Args) == kColumns, "EmplaceBack takes one argument per column");
+
+		auto values = std::forward_as_tuple(std::forward<Args>(args)...);
+		auto build = [&](const Columns& columns, size_t index) {
+			BuildColumns<0>([&](auto column) {
+				using Value = std::tuple_element_t<column, decltype(values)>;
+				new (std::get<column>(columns) + index) Field<column>(std::forward<Value>(std::get<column>(values)));
+			}, [&](auto column) {
+				std::destroy_at(std::get<column>(columns) + index);
+			});
+		};
+
+		if (size_ < capacity_) {
+			build(columns_, size_);
+		} else {
+			GrowAndBuild(Growth::template NextCapacity<value_type>(capacity_, size_ + 1), build);
+		}
+		return (*this)[size_++];
+	}
+
+	void PushBack(const value_type& row) {
+		std::apply([this](const Fields&... values) {
+			EmplaceBack(values...);
+		}, row);
+	}
+
+	void PushBack(value_type&& row) {
+		std::apply([this](Fields&... values) {
+			EmplaceBack(std::move(values)...);
+		}, row);
+	}
+
+	void PopBack() noexcept {
+		DestroyRows(size_ - 1, 1);
+		size_--;
+	}
+
+	// Shifting columns one after another could leave the rows out of step if
+	// an assignment threw half way, so Erase requires nothrow moves.
+	iterator Erase(const_iterator position) {
+		static_assert((std::is_nothrow_move_assignable_v<Fields> && ...),
+			"SoAVector::Erase requires nothrow move assignment");
+
+		size_t pos = position.Index();
+		ForEachColumn([&](auto column) {
+			using Type = Field<column>;
+			Type* data = ColumnData<column>();
+			if constexpr (IsTriviallyRelocatableV<Type>) {
+				std::destroy_at(data + pos);
+				detail::MemMoveN(data + pos + 1, size_ - pos - 1, data + pos);
+			} else {
+				std::move(data + pos + 1, data + size_, data + pos);
+				std::destroy_at(data + size_ - 1);
+			}
+		});
+		size_--;
+		return iterator(this, pos);
+	}
+
+	void Resize(size_t new_size) {
+		if (new_size < size_) {
+			DestroyRows(new_size, size_ - new_size);
+		} else if (new_size > size_) {
+			Reserve(new_size);
+			BuildColumns<0>([&](auto column) {
+				std::uninitialized_value_construct_n(ColumnData<column>() + size_, new_size - size_);
+			}, [&](auto column) {
+				std::destroy_n(ColumnData<column>() + size_, new_size - size_);
+			});
+		}
+		size_ = new_size;
+	}
+
+	void Reserve(size_t capacity) {
+		if (capacity_ < capacity) {
+			Reallocate(capacity);
+		}
+	}
+
+	void Clear() noexcept {
+		DestroyRows(0, size_);
+		size_ = 0;
+	}
+
+	void Swap(SoAVector& other) noexcept {
+		data_.Swap(other.data_);
+		std::swap(columns_, other.columns_);
+		std::swap(capacity_, other.capacity_);
+		std::swap(size_, other.size_);
+	}
+
+	size_t Size() const noexcept {
+		return size_;
+	}
+
+	size_t Capacity() const noexcept {
+		return capacity_;
+	}
+
+	reference operator[](size_t index) noexcept {
+		assert(index < size_);
+		return std::apply([index](Fields*... columns) {
+			return reference(columns[index]...);
+		}, columns_);
+	}
+
+	const_reference operator[](size_t index) const noexcept {
+		assert(index < size_);
+		return std::apply([index](Fields*... columns) {
+			return const_reference(columns[index]...);
+		}, columns_);
+	}
+
+private:
+	using Growth = DefaultGrowthPolicy;
+
+	static constexpr size_t AlignUp(size_t bytes) noexcept {
+		return (bytes + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+	}
+
+	static size_t BlocksFor(size_t capacity) noexcept {
+		return ((AlignUp(capacity * sizeof(Fields)) + ...)) / kCacheLineSize;
+	}
+
+	static Columns ColumnsFor(Block* base, size_t capacity) noexcept {
+		unsigned char* next = reinterpret_cast<unsigned char*>(base);
+		auto place = [&](auto* tag) {
+			using Type = std::remove_pointer_t<decltype(tag)>;
+			Type* column = reinterpret_cast<Type*>(next);
+			next += AlignUp(capacity * sizeof(Type));
+			return column;
+		};
+		return Columns{place(static_cast<Fields*>(nullptr))...};
+	}
+
+	template <typename Function>
+	static void ForEachColumn(Function&& fn) {
+		ForEachColumn(fn, std::index_sequence_for<Fields...>());
+	}
+
+	template <typename Function, size_t... I>
+	static void ForEachColumn(Function& fn, std::index_sequence<I...>) {
+		(fn(ColumnIndex<I>()), ...);
+	}
+
+	// Runs build for columns I, I + 1, ... in order. If a later column throws,
+	// undo is called for the columns that were already built.
+	template <size_t I, typename Build, typename Undo>
+	static void BuildColumns(Build&& build, Undo&& undo) {
+		if constexpr (I < kColumns) {
+			build(ColumnIndex<I>());
+			try {
+				BuildColumns<I + 1>(build, undo);
+			} catch (...) {
+				undo(ColumnIndex<I>());
+				throw;
+			}
+		}
+	}
+
+	void DestroyRows(size_t first, size_t count) noexcept {
+		ForEachColumn([&](auto column) {
+			std::destroy_n(ColumnData<column>() + first, count);
+		});
+	}
+
+	void Reallocate(size_t capacity) {
+		RawMemory<Block> new_data(BlocksFor(capacity));
+		Columns new_columns = ColumnsFor(new_data.GetAddress(), capacity);
+		CopyOrMoveInto(new_columns);
+		Adopt(new_data, new_columns, capacity);
+	}
+
+	// The new row is built before the old rows are moved, so arguments that
+	// refer to existing rows are still valid while it is constructed.
+	template <typename Build>
+	void GrowAndBuild(size_t capacity, Build& build) {
+		RawMemory<Block> new_data(BlocksFor(capacity));
+		Columns new_columns = ColumnsFor(new_data.GetAddress(), capacity);
+		build(static_cast<const Columns&>(new_columns), size_);
+		try {
+			CopyOrMoveInto(new_columns);
+		} catch (...) {
+			ForEachColumn([&](auto column) {
+				std::destroy_at(std::get<column>(new_columns) + size_);
+			});
+			throw;
+		}
+		Adopt(new_data, new_columns, capacity);
+	}
+
+	// Columns whose transfer may throw are copied first; the others are
+	// moved only once every copy has succeeded. Sources stay alive until
+	// Adopt, so a throwing copy leaves the vector unchanged.
+	void CopyOrMoveInto(const Columns& new_columns) {
+		BuildColumns<0>([&](auto column) {
+			if constexpr (!detail::IsNothrowRelocatableV<Field<column>>) {
+				detail::UninitializedMoveIfNoexceptN(ColumnData<column>(), size_, std::get<column>(new_columns));
+			}
+		}, [&](auto column) {
+			if constexpr (!detail::IsNothrowRelocatableV<Field<column>>) {
+				std::destroy_n(std::get<column>(new_columns), size_);
+			}
+		});
+		ForEachColumn([&](auto column) {
+			using Type = Field<column>;
+			if constexpr (IsTriviallyRelocatableV<Type>) {
+				detail::MemCopyN(ColumnData<column>(), size_, std::get<column>(new_columns));
+			} else if constexpr (detail::IsNothrowRelocatableV<Type>) {
+				detail::UninitializedMoveN(ColumnData<column>(), size_, std::get<column>(new_columns));
+			}
+		});
+	}
+
+	void Adopt(RawMemory<Block>& new_data, const Columns& new_columns, size_t capacity) noexcept {
+		ForEachColumn([&](auto column) {
+			if constexpr (!IsTriviallyRelocatableV<Field<column>>) {
+				std::destroy_n(ColumnData<column>(), size_);
+			}
+		});
+		data_.Swap(new_data);
+		columns_ = new_columns;
+		capacity_ = capacity;
+	}
+
+	RawMemory<Block> data_;
+	Columns columns_{};
+	size_t capacity_ = 0;
+	size_t size_ = 0;
+
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "vector.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Work-stealing pool: every worker owns a queue, runs its own tasks newest
+// first and steals the oldest tasks of other workers when it runs dry.
+// Threads that wait for a ParallelFor help out instead of blocking, so nested
+// parallel calls cannot deadlock the pool.
+class ThreadPool {
+public:
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
+		: queues_(threads != 0 ? threads : 1) {
+		for (size_t i = 0; i < queues_.Size(); ++i) {
+			queues_[i] = std::make_unique<Queue>();
+		}
+		workers_.Reserve(queues_.Size());
+		for (size_t i = 0; i < queues_.Size(); ++i) {
+			workers_.EmplaceBack([this, i] {
+				WorkerLoop(i);
+			});
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard lock(sleep_mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (std::thread& worker : workers_) {
+			worker.join();
+		}
+	}
+
+	// Pool shared by the parallel algorithms when none is passed explicitly.
+	static ThreadPool& Default() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	size_t Size() const noexcept {
+		return queues_.Size();
+	}
+
+	void Submit(std::function<void()> task) {
+		size_t index = current_pool_ == this
+			? current_index_
+			: next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.Size();
+		{
+			std::lock_guard lock(queues_[index]->mutex);
+			queues_[index]->tasks.push_back(std::move(task));
+		}
+		pending_.fetch_add(1, std::memory_order_release);
+		{
+			std::lock_guard lock(sleep_mutex_);
+		}
+		wake_.notify_one();
+	}
+
+	// Runs one queued task on the calling thread, if there is any.
+	bool TryRunPendingTask() {
+		std::function<void()> task;
+		size_t home = current_pool_ == this ? current_index_ : 0;
+		if (!TryPop(home, task)) {
+			return false;
+		}
+		task();
+		return true;
+	}
+
+	// Calls body(i) for every i in [0, tasks) and returns once all calls have
+	// finished. The calling thread takes part. The first exception thrown by
+	// body is rethrown here after all tasks have completed.
+	template <typename Body>
+	void ParallelFor(size_t tasks, Body&& body) {
+		if (tasks == 0) {
+			return;
+		}
+
+		std::atomic<size_t> remaining(tasks);
+		std::exception_ptr error;
+		std::mutex error_mutex;
+		auto run = [&](size_t i) {
+			try {
+				body(i);
+			} catch (...) {
+				std::lock_guard lock(error_mutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+			remaining.fetch_sub(1, std::memory_order_acq_rel);
+		};
+
+		for (size_t i = 1; i < tasks; ++i) {
+			Submit([&run, i] {
+				run(i);
+			});
+		}
+		run(0);
+
+		while (remaining.load(std::memory_order_acquire) != 0) {
+			if (!TryRunPendingTask()) {
+				std::this_thread::yield();
+			}
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	bool TryPop(size_t home, std::function<void()>& task) {
+		if (pending_.load(std::memory_order_acquire) == 0) {
+			return false;
+		}
+
+		for (size_t offset = 0; offset < queues_.Size(); ++offset) {
+			Queue& queue = *queues_[(home + offset) % queues_.Size()];
+			std::lock_guard lock(queue.mutex);
+			if (queue.tasks.empty()) {
+				continue;
+			}
+			if (offset == 0) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			} else {
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			pending_.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	void WorkerLoop(size_t index) {
+		current_pool_ = this;
+		current_index_ = index;
+
+		std::function<void()> task;
+		while (true) {
+			if (TryPop(index, task)) {
+				task();
+				task = nullptr;
+				continue;
+			}
+
+			std::unique_lock lock(sleep_mutex_);
+			wake_.wait(lock, [this] {
+				return stop_ || pending_.load(std::memory_order_acquire) != 0;
+			});
+			if (stop_ && pending_.load(std::memory_order_acquire) == 0) {
+				return;
+			}
+		}
+	}
+
+	inline static thread_local ThreadPool* current_pool_ = nullptr;
+	inline static thread_local size_t current_index_ = 0;
+
+	Vector<std::unique_ptr<Queue>> queues_;
+	Vector<std::thread> workers_;
+	std::atomic<size_t> pending_{0};
+	std::atomic<size_t> next_queue_{0};
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+	bool stop_ = false;
+
+};
@@ -2,19 +2,775 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <new>
 #include <utility>
 #include <memory>
 #include <iostream>
 #include <algorithm>
+#include <iterator>
+#include <memory_resource>
 
+// Hardened mode, meant for debug builds: define VECTOR_HARDENED to make every
+// accessor bounds-checked even under NDEBUG, to give Vector checked
+// iterators that detect use after reallocation, and, under AddressSanitizer,
+// to poison the unused capacity. Without it the checks are plain asserts and
+// iterators are raw pointers.
+#if defined(VECTOR_HARDENED)
+#include <cstdio>
+
+#define VECTOR_CHECK(condition, message) \
+	((condition) ? static_cast<void>(0) : ::detail::HardeningFailure(message, __FILE__, __LINE__))
+
+#if defined(__SANITIZE_ADDRESS__)
+#define VECTOR_ANNOTATE_CONTAINER 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define VECTOR_ANNOTATE_CONTAINER 1
+#endif
+#endif
+
+#if defined(VECTOR_ANNOTATE_CONTAINER)
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+namespace detail {
+
+[[noreturn]] inline void HardeningFailure(const char* message, const char* file, int line) noexcept {
+	std::fprintf(stderr, "%s:%d: vector check failed: %s\n", file, line, message);
+	std::abort();
+}
+
+}
+#else
+#define VECTOR_CHECK(condition, message) assert((condition) && message)
+#endif
+
+// With C++20 transient allocation the core of RawMemory and Vector
+// (construction, growth, element access, iteration and destruction) is
+// usable in constant expressions, so tables can be built at compile time
+// and copied into an InplaceVector or a static array.
+#if defined(__cpp_constexpr_dynamic_alloc) && defined(__cpp_lib_constexpr_dynamic_alloc)
+#define VECTOR_CONSTEXPR20 constexpr
+#else
+#define VECTOR_CONSTEXPR20
+#endif
+
+// Types for which moving an object to a new address and ending the lifetime
+// of the original is equivalent to copying its bytes. Trivially copyable
+// types qualify automatically; handle types can opt in by specializing:
+//
+//	template <>
+//	struct IsTriviallyRelocatable<MyString> : std::true_type {};
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+struct IsTriviallyRelocatable<std::unique_ptr<T>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool IsTriviallyRelocatableV = IsTriviallyRelocatable<T>::value;
+
+namespace detail {
+
+template <typename It>
+using IteratorCategory = typename std::iterator_traits<It>::iterator_category;
+
+template <typename It, typename = void>
+inline constexpr bool IsInputIteratorV = false;
+
+template <typename It>
+inline constexpr bool IsInputIteratorV<It, std::void_t<IteratorCategory<It>>> =
+	std::is_base_of_v<std::input_iterator_tag, IteratorCategory<It>>;
+
+template <typename It>
+inline constexpr bool IsForwardIteratorV = IsInputIteratorV<It>
+	&& std::is_base_of_v<std::forward_iterator_tag, IteratorCategory<It>>;
+
+// True while the enclosing call is being constant-evaluated. memcpy and the
+// uninitialized memory algorithms are not usable there, so the helpers below
+// fall back to element-wise construction; a throw ends constant evaluation,
+// which is why those fallbacks need no rollback. Before C++20 only trivial
+// element types get there, and ConstructAt assigns instead.
+constexpr bool IsConstantEvaluated() noexcept {
+#if defined(__cpp_lib_is_constant_evaluated)
+	return std::is_constant_evaluated();
+#elif defined(__GNUC__)
+	return __builtin_is_constant_evaluated();
+#else
+	return false;
+#endif
+}
+
+template <typename T, typename... Args>
+constexpr void ConstructAt(T* location, Args&&... args) {
+#if defined(__cpp_lib_constexpr_dynamic_alloc)
+	std::construct_at(location, std::forward<Args>(args)...);
+#else
+	if constexpr (std::is_trivial_v<T>) {
+		if (IsConstantEvaluated()) {
+			*location = T(std::forward<Args>(args)...);
+			return;
+		}
+	}
+	new (location) T(std::forward<Args>(args)...);
+#endif
+}
+
+template <typename T>
+constexpr void DestroyN(T* first, size_t n) noexcept {
+	if constexpr (!std::is_trivially_destructible_v<T>) {
+		std::destroy_n(first, n);
+	}
+}
+
+// Constexpr stand-ins for the uninitialized memory algorithms.
+template <typename T>
+VECTOR_CONSTEXPR20 void UninitializedValueConstructN(T* dst, size_t n) {
+	if (IsConstantEvaluated()) {
+		for (size_t i = 0; i < n; ++i) {
+			ConstructAt(dst + i);
+		}
+	} else {
+		std::uninitialized_value_construct_n(dst, n);
+	}
+}
+
+template <typename InputIt, typename T>
+VECTOR_CONSTEXPR20 void UninitializedCopyN(InputIt src, size_t n, T* dst) {
+	if (IsConstantEvaluated()) {
+		for (size_t i = 0; i < n; ++i, ++src) {
+			ConstructAt(dst + i, *src);
+		}
+	} else {
+		std::uninitialized_copy_n(src, n, dst);
+	}
+}
+
+template <typename T>
+VECTOR_CONSTEXPR20 void UninitializedMoveN(T* src, size_t n, T* dst) {
+	if (IsConstantEvaluated()) {
+		UninitializedCopyN(std::make_move_iterator(src), n, dst);
+	} else {
+		std::uninitialized_move_n(src, n, dst);
+	}
+}
+
+template <typename T>
+VECTOR_CONSTEXPR20 void UninitializedMoveIfNoexceptN(T* src, size_t n, T* dst) {
+	if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+		UninitializedMoveN(src, n, dst);
+	} else {
+		UninitializedCopyN(src, n, dst);
+	}
+}
+
+template <typename T>
+void MemCopyN(T* src, size_t n, T* dst) noexcept {
+	if (n != 0) {
+		std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), n * sizeof(T));
+	}
+}
+
+template <typename T>
+void MemMoveN(T* src, size_t n, T* dst) noexcept {
+	if (n != 0) {
+		std::memmove(static_cast<void*>(dst), static_cast<const void*>(src), n * sizeof(T));
+	}
+}
+
+// Moves n live objects from src into uninitialized dst and ends their
+// lifetime in src. If T is copied and a copy throws, src is left intact.
+template <typename T>
+VECTOR_CONSTEXPR20 void UninitializedRelocateN(T* src, size_t n, T* dst) {
+	if constexpr (IsTriviallyRelocatableV<T>) {
+		if (!IsConstantEvaluated()) {
+			MemCopyN(src, n, dst);
+			return;
+		}
+	}
+	UninitializedMoveIfNoexceptN(src, n, dst);
+	DestroyN(src, n);
+}
+
+// Relocation that cannot throw lets callers drop their cleanup handlers.
+template <typename T>
+inline constexpr bool IsNothrowRelocatableV = IsTriviallyRelocatableV<T> || std::is_nothrow_move_constructible_v<T>;
+
+// Same as UninitializedRelocateN, but leaves a hole of gap_size elements
+// at dst + gap.
+template <typename T>
+VECTOR_CONSTEXPR20 void UninitializedRelocateWithGapN(T* src, size_t n, size_t gap, T* dst, size_t gap_size = 1) {
+	if constexpr (IsTriviallyRelocatableV<T>) {
+		if (!IsConstantEvaluated()) {
+			MemCopyN(src, gap, dst);
+			MemCopyN(src + gap, n - gap, dst + gap + gap_size);
+			return;
+		}
+	}
+	UninitializedMoveIfNoexceptN(src, gap, dst);
+	if constexpr (IsNothrowRelocatableV<T>) {
+		UninitializedMoveIfNoexceptN(src + gap, n - gap, dst + gap + gap_size);
+	} else {
+		try {
+			UninitializedMoveIfNoexceptN(src + gap, n - gap, dst + gap + gap_size);
+		} catch (...) {
+			DestroyN(dst, gap);
+			throw;
+		}
+	}
+	DestroyN(src, n);
+}
+
+// Relocates n elements from src into a new buffer around the gap_size
+// elements already built at dst + gap. If a copy throws, those are destroyed
+// again and src is left intact, which gives growing inserts the strong
+// guarantee.
+template <typename T>
+VECTOR_CONSTEXPR20 void RelocateAroundN(T* src, size_t n, size_t gap, T* dst, size_t gap_size = 1) {
+	if constexpr (IsNothrowRelocatableV<T>) {
+		UninitializedRelocateWithGapN(src, n, gap, dst, gap_size);
+	} else {
+		try {
+			UninitializedRelocateWithGapN(src, n, gap, dst, gap_size);
+		} catch (...) {
+			DestroyN(dst + gap, gap_size);
+			throw;
+		}
+	}
+}
+
+template <typename T>
+constexpr void MoveAssign(T* first, T* last, T* dst) {
+	if (IsConstantEvaluated()) {
+		while (first != last) {
+			*dst++ = std::move(*first++);
+		}
+	} else {
+		std::move(first, last, dst);
+	}
+}
+
+template <typename T>
+constexpr void MoveAssignBackward(T* first, T* last, T* dst_last) {
+	if (IsConstantEvaluated()) {
+		while (first != last) {
+			*--dst_last = std::move(*--last);
+		}
+	} else {
+		std::move_backward(first, last, dst_last);
+	}
+}
+
+// Element shuffling shared by the contiguous containers that insert and
+// erase in place.
+
+// Relocates the element just built at data + size to data + pos, shifting
+// [pos, size) up one slot. Only for trivially relocatable T.
+template <typename T>
+void RotateLastInto(T* data, size_t size, size_t pos) noexcept {
+	alignas(T) unsigned char bytes[sizeof(T)];
+	std::memcpy(bytes, static_cast<void*>(data + size), sizeof(T));
+	MemMoveN(data + pos, size - pos, data + pos + 1);
+	std::memcpy(static_cast<void*>(data + pos), bytes, sizeof(T));
+}
+
+// True when Args is a single rvalue of T, which by the usual library rule
+// does not alias an element of the container.
+template <typename T, typename... Args>
+inline constexpr bool IsSingleRvalueV = false;
+
+template <typename T, typename Arg>
+inline constexpr bool IsSingleRvalueV<T, Arg> = std::is_same_v<Arg, T>;
+
+// Constructs a new element at data + pos, where data holds size live
+// elements and has room for one more, shifting the tail up one slot. size
+// is bumped as soon as the extra slot is live, so a move that throws part
+// way still leaves every constructed element counted.
+//
+// Trivially relocatable elements are built in the spare slot and then
+// relocated into place, so there is no temporary, no assignment, and a
+// throwing constructor leaves the elements untouched. A single rvalue is
+// assigned straight into the slot. Anything else may refer to an element
+// that is about to move, so it goes through a temporary.
+template <typename T, typename... Args>
+constexpr void EmplaceShift(T* data, size_t& size, size_t pos, Args&&... args) {
+	T* last = data + size;
+	if (pos == size) {
+		ConstructAt(last, std::forward<Args>(args)...);
+		++size;
+		return;
+	}
+
+	if constexpr (IsTriviallyRelocatableV<T>) {
+		if (!IsConstantEvaluated()) {
+			ConstructAt(last, std::forward<Args>(args)...);
+			RotateLastInto(data, size, pos);
+			++size;
+			return;
+		}
+	}
+
+	if constexpr (IsSingleRvalueV<T, Args...>) {
+		ConstructAt(last, std::move(last[-1]));
+		++size;
+		MoveAssignBackward(data + pos, last - 1, last);
+		data[pos] = (std::forward<Args>(args), ...);
+	} else {
+		T tmp_obj(std::forward<Args>(args)...);
+		ConstructAt(last, std::move(last[-1]));
+		++size;
+		MoveAssignBackward(data + pos, last - 1, last);
+		data[pos] = std::move(tmp_obj);
+	}
+}
+
+// Destroys count elements at data + pos out of size live ones and closes
+// the gap. The caller subtracts count from its size.
+template <typename T>
+constexpr void EraseShiftN(T* data, size_t size, size_t pos, size_t count) {
+	if constexpr (IsTriviallyRelocatableV<T>) {
+		if (!IsConstantEvaluated()) {
+			std::destroy_n(data + pos, count);
+			MemMoveN(data + pos + count, size - pos - count, data + pos);
+			return;
+		}
+	}
+	MoveAssign(data + pos + count, data + size, data + pos);
+	DestroyN(data + size - count, count);
+}
+
+}
+
+inline constexpr size_t kCacheLineSize = 64;
+
+// Growth policies decide the capacity of the next buffer once the current one
+// is full. NextCapacity must return a value of at least `required`.
+struct DoublingGrowthPolicy {
+	template <typename T>
+	static constexpr size_t NextCapacity(size_t capacity, size_t required) noexcept {
+		size_t next = capacity == 0 ? 1 : capacity * 2;
+		return next < capacity || next < required ? required : next;
+	}
+};
+
+// Grows by 1.5x, starts with at least one cache line worth of elements and
+// never adds more than MaxStepBytes at once, so huge buffers do not
+// over-allocate by gigabytes.
+template <size_t MaxStepBytes = (size_t(256) << 20)>
+struct GeometricGrowthPolicy {
+	template <typename T>
+	static constexpr size_t NextCapacity(size_t capacity, size_t required) noexcept {
+		constexpr size_t min_capacity = sizeof(T) < kCacheLineSize ? kCacheLineSize / sizeof(T) : 1;
+		constexpr size_t max_step = MaxStepBytes / sizeof(T) != 0 ? MaxStepBytes / sizeof(T) : 1;
+
+		size_t step = std::clamp<size_t>(capacity / 2, 1, max_step);
+		size_t next = capacity + step < capacity ? required : capacity + step;
+		return std::max({next, required, min_capacity});
+	}
+};
+
+using DefaultGrowthPolicy = GeometricGrowthPolicy<>;
+
+// Execution policies select the parallel overloads of Vector operations. A
+// policy provides Concurrency() and ParallelFor(tasks, body), which calls
+// body(i) for every task index and rethrows the first exception once all
+// tasks are done. parallel.h defines ParallelPolicy on top of ThreadPool.
+template <typename Policy>
+struct IsExecutionPolicy : std::false_type {};
+
+template <typename Policy>
+inline constexpr bool IsExecutionPolicyV = IsExecutionPolicy<std::decay_t<Policy>>::value;
+
+namespace detail {
+
+inline constexpr size_t kMinParallelChunkBytes = size_t(32) << 10;
+
+// Splits [first, first + n) into at most `chunks` pieces and returns the
+// index of boundary i, rounded up to the next element that starts a cache
+// line. Boundary 0 is always 0 and boundary `chunks` is always n.
+template <typename T>
+size_t ChunkBoundary(const T* first, size_t n, size_t chunks, size_t i) noexcept {
+	if (i == 0) {
+		return 0;
+	}
+	if (i >= chunks) {
+		return n;
+	}
+
+	size_t index = n / chunks * i + n % chunks * i / chunks;
+	uintptr_t address = reinterpret_cast<uintptr_t>(first + index);
+	uintptr_t aligned = (address + kCacheLineSize - 1) & ~(uintptr_t(kCacheLineSize) - 1);
+	index += (aligned - address + sizeof(T) - 1) / sizeof(T);
+	return std::min(index, n);
+}
+
+template <typename T>
+size_t ChunkCount(size_t n, size_t concurrency) noexcept {
+	size_t min_chunk = std::max<size_t>(1, kMinParallelChunkBytes / sizeof(T));
+	size_t by_size = (n + min_chunk - 1) / min_chunk;
+	return std::max<size_t>(1, std::min(by_size, concurrency * 4));
+}
+
+// Runs construct(begin, end) for chunks of the uninitialized range
+// [dst, dst + n) on the policy's workers. construct must leave its chunk
+// either fully built or untouched. If any chunk throws, the chunks that did
+// complete are destroyed before the exception propagates.
+template <typename T, typename Policy, typename Construct>
+void ParallelUninitializedChunks(Policy& policy, T* dst, size_t n, Construct&& construct) {
+	size_t chunks = ChunkCount<T>(n, policy.Concurrency());
+	std::unique_ptr<bool[]> done(new bool[chunks]());
+	try {
+		policy.ParallelFor(chunks, [&](size_t i) {
+			size_t begin = ChunkBoundary(dst, n, chunks, i);
+			size_t end = ChunkBoundary(dst, n, chunks, i + 1);
+			construct(begin, end);
+			done[i] = true;
+		});
+	} catch (...) {
+		for (size_t i = 0; i < chunks; ++i) {
+			if (done[i]) {
+				size_t begin = ChunkBoundary(dst, n, chunks, i);
+				std::destroy_n(dst + begin, ChunkBoundary(dst, n, chunks, i + 1) - begin);
+			}
+		}
+		throw;
+	}
+}
+
+template <typename T, typename Policy>
+void ParallelDestroyN(Policy& policy, T* first, size_t n) noexcept {
+	if constexpr (!std::is_trivially_destructible_v<T>) {
+		size_t chunks = ChunkCount<T>(n, policy.Concurrency());
+		try {
+			policy.ParallelFor(chunks, [&](size_t i) {
+				size_t begin = ChunkBoundary(first, n, chunks, i);
+				std::destroy_n(first + begin, ChunkBoundary(first, n, chunks, i + 1) - begin);
+			});
+		} catch (...) {
+			std::terminate();
+		}
+	}
+}
+
+}
+
+// Selects constructors that default-initialize elements, leaving trivial
+// types uninitialized instead of zero-filling them.
+struct DefaultInitTag {
+	explicit DefaultInitTag() = default;
+};
+
+inline constexpr DefaultInitTag kDefaultInit{};
+
+namespace detail {
+
+// Raw element pointer behind a contiguous iterator, for the algorithms that
+// hand whole ranges to memcpy-like kernels. Does not check the iterator.
 template <typename T>
+constexpr T* ToAddress(T* pointer) noexcept {
+	return pointer;
+}
+
+template <typename Iterator>
+constexpr auto ToAddress(const Iterator& it) noexcept -> decltype(it.Base()) {
+	return it.Base();
+}
+
+#if defined(VECTOR_HARDENED)
+// Iterator of hardened builds. It remembers its container and the buffer
+// generation it was created for, and checks both on every access, so using
+// it after PushBack/Reserve/Emplace reallocated, or after the container was
+// moved from or swapped, aborts instead of touching freed memory.
+template <typename Container, typename T>
+class CheckedIterator {
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::remove_cv_t<T>;
+	using difference_type = ptrdiff_t;
+	using pointer = T*;
+	using reference = T&;
+
+	CheckedIterator() noexcept = default;
+
+	VECTOR_CONSTEXPR20 CheckedIterator(Container* owner, T* pointer) noexcept
+		: owner_(owner), pointer_(pointer), generation_(owner->Generation()) {
+
+	}
+
+	template <typename OtherContainer, typename U,
+		typename = std::enable_if_t<std::is_convertible_v<U*, T*> && !std::is_same_v<U, T>>>
+	VECTOR_CONSTEXPR20 CheckedIterator(const CheckedIterator<OtherContainer, U>& other) noexcept
+		: owner_(other.owner_), pointer_(other.pointer_), generation_(other.generation_) {
+
+	}
+
+	VECTOR_CONSTEXPR20 reference operator*() const noexcept {
+		CheckDereferenceable();
+		return *pointer_;
+	}
+
+	VECTOR_CONSTEXPR20 pointer operator->() const noexcept {
+		CheckDereferenceable();
+		return pointer_;
+	}
+
+	VECTOR_CONSTEXPR20 reference operator[](difference_type offset) const noexcept {
+		return *(*this + offset);
+	}
+
+	VECTOR_CONSTEXPR20 T* Base() const noexcept {
+		return pointer_;
+	}
+
+	VECTOR_CONSTEXPR20 Container* Owner() const noexcept {
+		return owner_;
+	}
+
+	VECTOR_CONSTEXPR20 CheckedIterator& operator++() noexcept {
+		++pointer_;
+		return *this;
+	}
+
+	VECTOR_CONSTEXPR20 CheckedIterator operator++(int) noexcept {
+		CheckedIterator it = *this;
+		++pointer_;
+		return it;
+	}
+
+	VECTOR_CONSTEXPR20 CheckedIterator& operator--() noexcept {
+		--pointer_;
+		return *this;
+	}
+
+	VECTOR_CONSTEXPR20 CheckedIterator operator--(int) noexcept {
+		CheckedIterator it = *this;
+		--pointer_;
+		return it;
+	}
+
+	VECTOR_CONSTEXPR20 CheckedIterator& operator+=(difference_type offset) noexcept {
+		pointer_ += offset;
+		return *this;
+	}
+
+	VECTOR_CONSTEXPR20 CheckedIterator& operator-=(difference_type offset) noexcept {
+		pointer_ -= offset;
+		return *this;
+	}
+
+	friend VECTOR_CONSTEXPR20 CheckedIterator operator+(CheckedIterator it, difference_type offset) noexcept {
+		return it += offset;
+	}
+
+	friend VECTOR_CONSTEXPR20 CheckedIterator operator+(difference_type offset, CheckedIterator it) noexcept {
+		return it += offset;
+	}
+
+	friend VECTOR_CONSTEXPR20 CheckedIterator operator-(CheckedIterator it, difference_type offset) noexcept {
+		return it -= offset;
+	}
+
+	friend VECTOR_CONSTEXPR20 difference_type operator-(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+		lhs.CheckComparable(rhs);
+		return lhs.pointer_ - rhs.pointer_;
+	}
+
+	friend VECTOR_CONSTEXPR20 bool operator==(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+		lhs.CheckComparable(rhs);
+		return lhs.pointer_ == rhs.pointer_;
+	}
+
+	friend VECTOR_CONSTEXPR20 bool operator!=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+
+	friend VECTOR_CONSTEXPR20 bool operator<(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+		lhs.CheckComparable(rhs);
+		return lhs.pointer_ < rhs.pointer_;
+	}
+
+	friend VECTOR_CONSTEXPR20 bool operator>(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+		return rhs < lhs;
+	}
+
+	friend VECTOR_CONSTEXPR20 bool operator<=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+		return !(rhs < lhs);
+	}
+
+	friend VECTOR_CONSTEXPR20 bool operator>=(const CheckedIterator& lhs, const CheckedIterator& rhs) noexcept {
+		return !(lhs < rhs);
+	}
+
+	// Valid: created for the current buffer of a live container and within
+	// [begin, end]. Dereferenceable additionally excludes end.
+	VECTOR_CONSTEXPR20 void CheckValid() const noexcept {
+		VECTOR_CHECK(owner_ != nullptr, "singular iterator");
+		VECTOR_CHECK(generation_ == owner_->Generation(), "iterator invalidated by reallocation");
+		VECTOR_CHECK(pointer_ >= owner_->Data() && pointer_ <= owner_->Data() + owner_->Size(),
+			"iterator out of range");
+	}
+
+private:
+	template <typename, typename>
+	friend class CheckedIterator;
+
+	VECTOR_CONSTEXPR20 void CheckDereferenceable() const noexcept {
+		CheckValid();
+		VECTOR_CHECK(pointer_ != owner_->Data() + owner_->Size(), "end iterator dereferenced");
+	}
+
+	VECTOR_CONSTEXPR20 void CheckComparable(const CheckedIterator& other) const noexcept {
+		VECTOR_CHECK(owner_ == other.owner_, "iterators of different containers");
+		VECTOR_CHECK(owner_ == nullptr || (generation_ == owner_->Generation() && other.generation_ == generation_),
+			"iterator invalidated by reallocation");
+	}
+
+	Container* owner_ = nullptr;
+	T* pointer_ = nullptr;
+	uint64_t generation_ = 0;
+};
+#endif
+
+// Random-access iterator holding its container and an element index, which
+// dereferences through the container's operator[]. For containers whose
+// elements do not sit in one contiguous block.
+template <typename Owner, typename T>
+class IndexIterator {
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = std::remove_cv_t<T>;
+	using difference_type = ptrdiff_t;
+	using pointer = T*;
+	using reference = T&;
+
+	IndexIterator() noexcept = default;
+
+	IndexIterator(Owner* owner, size_t index) noexcept
+		: owner_(owner), index_(index) {
+
+	}
+
+	template <typename OtherOwner, typename U,
+		typename = std::enable_if_t<std::is_convertible_v<U*, T*> && !std::is_same_v<U, T>>>
+	IndexIterator(const IndexIterator<OtherOwner, U>& other) noexcept
+		: owner_(other.owner_), index_(other.index_) {
+
+	}
+
+	reference operator*() const noexcept {
+		return (*owner_)[index_];
+	}
+
+	pointer operator->() const noexcept {
+		return &(*owner_)[index_];
+	}
+
+	reference operator[](difference_type offset) const noexcept {
+		return (*owner_)[index_ + offset];
+	}
+
+	size_t Index() const noexcept {
+		return index_;
+	}
+
+	IndexIterator& operator++() noexcept {
+		++index_;
+		return *this;
+	}
+
+	IndexIterator operator++(int) noexcept {
+		return IndexIterator(owner_, index_++);
+	}
+
+	IndexIterator& operator--() noexcept {
+		--index_;
+		return *this;
+	}
+
+	IndexIterator operator--(int) noexcept {
+		return IndexIterator(owner_, index_--);
+	}
+
+	IndexIterator& operator+=(difference_type offset) noexcept {
+		index_ += offset;
+		return *this;
+	}
+
+	IndexIterator& operator-=(difference_type offset) noexcept {
+		index_ -= offset;
+		return *this;
+	}
+
+	friend IndexIterator operator+(IndexIterator it, difference_type offset) noexcept {
+		return it += offset;
+	}
+
+	friend IndexIterator operator+(difference_type offset, IndexIterator it) noexcept {
+		return it += offset;
+	}
+
+	friend IndexIterator operator-(IndexIterator it, difference_type offset) noexcept {
+		return it -= offset;
+	}
+
+	friend difference_type operator-(const IndexIterator& lhs, const IndexIterator& rhs) noexcept {
+		return static_cast<difference_type>(lhs.index_) - static_cast<difference_type>(rhs.index_);
+	}
+
+	friend bool operator==(const IndexIterator& lhs, const IndexIterator& rhs) noexcept {
+		return lhs.index_ == rhs.index_;
+	}
+
+	friend bool operator!=(const IndexIterator& lhs, const IndexIterator& rhs) noexcept {
+		return lhs.index_ != rhs.index_;
+	}
+
+	friend bool operator<(const IndexIterator& lhs, const IndexIterator& rhs) noexcept {
+		return lhs.index_ < rhs.index_;
+	}
+
+	friend bool operator>(const IndexIterator& lhs, const IndexIterator& rhs) noexcept {
+		return lhs.index_ > rhs.index_;
+	}
+
+	friend bool operator<=(const IndexIterator& lhs, const IndexIterator& rhs) noexcept {
+		return lhs.index_ <= rhs.index_;
+	}
+
+	friend bool operator>=(const IndexIterator& lhs, const IndexIterator& rhs) noexcept {
+		return lhs.index_ >= rhs.index_;
+	}
+
+private:
+	template <typename, typename>
+	friend class IndexIterator;
+
+	Owner* owner_ = nullptr;
+	size_t index_ = 0;
+};
+
+}
+
+template <typename T, typename Alloc = std::allocator<T>>
 class RawMemory {
+	using AllocTraits = std::allocator_traits<Alloc>;
+
 public:
+	using allocator_type = Alloc;
+
 	RawMemory() = default;
 
-	explicit RawMemory(size_t capacity)
-		: buffer_(Allocate(capacity))
+	VECTOR_CONSTEXPR20 explicit RawMemory(const Alloc& alloc) noexcept
+		: alloc_(alloc) {
+
+	}
+
+	VECTOR_CONSTEXPR20 explicit RawMemory(size_t capacity, const Alloc& alloc = Alloc())
+		: alloc_(alloc)
+		, buffer_(Allocate(capacity))
 		, capacity_(capacity) {
 
 	}
@@ -23,208 +779,456 @@ public:
 
 	RawMemory& operator=(const RawMemory& rhs) = delete;
 
-	RawMemory(RawMemory&& other) noexcept {
-		buffer_ = std::move(other.buffer_);
-		capacity_ = std::move(other.capacity_);
-
-		other.buffer_ = nullptr;
-		other.capacity_ = 0;
+	VECTOR_CONSTEXPR20 RawMemory(RawMemory&& other) noexcept
+		: alloc_(std::move(other.alloc_))
+		, buffer_(std::exchange(other.buffer_, nullptr))
+		, capacity_(std::exchange(other.capacity_, 0)) {
+		other.BumpGeneration();
 	}
 
-	RawMemory& operator=(RawMemory&& rhs) noexcept {
-		buffer_ = std::move(rhs.buffer_);
-		capacity_ = std::move(rhs.capacity_);
+	VECTOR_CONSTEXPR20 RawMemory& operator=(RawMemory&& rhs) noexcept {
+		if (this == &rhs) {
+			return *this;
+		}
 
-		rhs.buffer_ = nullptr;
-		rhs.capacity_ = 0;
+		Deallocate(buffer_, capacity_);
+		if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+			alloc_ = std::move(rhs.alloc_);
+		} else {
+			assert(alloc_ == rhs.alloc_);
+		}
+		buffer_ = std::exchange(rhs.buffer_, nullptr);
+		capacity_ = std::exchange(rhs.capacity_, 0);
+		BumpGeneration();
+		rhs.BumpGeneration();
 
 		return *this;
 	}
 
-	~RawMemory() {
-		Deallocate(buffer_);
+	VECTOR_CONSTEXPR20 ~RawMemory() {
+		Deallocate(buffer_, capacity_);
 	}
 
-	T* operator+(size_t offset) noexcept {
-		assert(offset <= capacity_);
+	VECTOR_CONSTEXPR20 T* operator+(size_t offset) noexcept {
+		VECTOR_CHECK(offset <= capacity_, "RawMemory offset out of range");
 		return buffer_ + offset;
 	}
 
-	const T* operator+(size_t offset) const noexcept {
+	VECTOR_CONSTEXPR20 const T* operator+(size_t offset) const noexcept {
 		return const_cast<RawMemory&>(*this) + offset;
 	}
 
-	const T& operator[](size_t index) const noexcept {
+	VECTOR_CONSTEXPR20 const T& operator[](size_t index) const noexcept {
 		return const_cast<RawMemory&>(*this)[index];
 	}
 
-	T& operator[](size_t index) noexcept {
-		assert(index < capacity_);
+	VECTOR_CONSTEXPR20 T& operator[](size_t index) noexcept {
+		VECTOR_CHECK(index < capacity_, "RawMemory index out of range");
 		return buffer_[index];
 	}
 
-	void Swap(RawMemory& other) noexcept {
+	// Allocators are exchanged only when they propagate on swap, otherwise
+	// they must compare equal, exactly as for standard containers.
+	VECTOR_CONSTEXPR20 void Swap(RawMemory& other) noexcept {
+		if constexpr (AllocTraits::propagate_on_container_swap::value) {
+			using std::swap;
+			swap(alloc_, other.alloc_);
+		} else {
+			assert(alloc_ == other.alloc_);
+		}
 		std::swap(buffer_, other.buffer_);
 		std::swap(capacity_, other.capacity_);
+		BumpGeneration();
+		other.BumpGeneration();
 	}
 
-	const T* GetAddress() const noexcept {
+	// Frees the buffer and switches to another allocator. Used by containers
+	// whose allocator propagates on copy assignment.
+	VECTOR_CONSTEXPR20 void Reset(const Alloc& alloc) noexcept {
+		Deallocate(buffer_, capacity_);
+		buffer_ = nullptr;
+		capacity_ = 0;
+		alloc_ = alloc;
+		BumpGeneration();
+	}
+
+	// Takes over an allocator that compares equal to the current one, for
+	// containers whose allocator propagates on copy assignment: the buffer
+	// stays, but state such as a placement policy follows the source.
+	VECTOR_CONSTEXPR20 void SetAllocator(const Alloc& alloc) noexcept {
+		assert(alloc_ == alloc);
+		alloc_ = alloc;
+	}
+
+	VECTOR_CONSTEXPR20 const T* GetAddress() const noexcept {
 		return buffer_;
 	}
 
-	T* GetAddress() noexcept {
+	VECTOR_CONSTEXPR20 T* GetAddress() noexcept {
 		return buffer_;
 	}
 
-	size_t Capacity() const {
+	VECTOR_CONSTEXPR20 size_t Capacity() const {
 		return capacity_;
 	}
 
+	VECTOR_CONSTEXPR20 const Alloc& GetAllocator() const noexcept {
+		return alloc_;
+	}
+
+	// Changes whenever the buffer is replaced, moved from or swapped, so
+	// checked iterators can tell that their pointer went stale. Always zero
+	// outside hardened builds.
+	VECTOR_CONSTEXPR20 uint64_t Generation() const noexcept {
+#if defined(VECTOR_HARDENED)
+		return generation_;
+#else
+		return 0;
+#endif
+	}
+
 private:
-	static T* Allocate(size_t n) {
-		return n != 0 ? static_cast<T*>(operator new(n * sizeof(T))) : nullptr;
+	VECTOR_CONSTEXPR20 void BumpGeneration() noexcept {
+#if defined(VECTOR_HARDENED)
+		++generation_;
+#endif
 	}
 
-	static void Deallocate(T* buf) noexcept {
-		operator delete(buf);
+	// Constant evaluation goes through std::allocator whatever Alloc is.
+	// Such buffers never outlive the evaluation, so the two never mix.
+	VECTOR_CONSTEXPR20 T* Allocate(size_t n) {
+		if (n == 0) {
+			return nullptr;
+		}
+		if (detail::IsConstantEvaluated()) {
+			return std::allocator<T>().allocate(n);
+		}
+		return AllocTraits::allocate(alloc_, n);
 	}
 
+	VECTOR_CONSTEXPR20 void Deallocate(T* buf, size_t n) noexcept {
+		if (buf == nullptr) {
+			return;
+		}
+		if (detail::IsConstantEvaluated()) {
+			std::allocator<T>().deallocate(buf, n);
+		} else {
+			AllocTraits::deallocate(alloc_, buf, n);
+		}
+	}
+
+	[[no_unique_address]] Alloc alloc_ = Alloc();
 	T* buffer_ = nullptr;
 	size_t capacity_ = 0;
+#if defined(VECTOR_HARDENED)
+	uint64_t generation_ = 0;
+#endif
 };
 
-template <typename T>
+// Instrumentation policy for Vector. The hooks receive bytes allocated for a
+// new buffer, the size, bytes and new capacity of each growth, elements
+// shifted by Erase/Emplace and size and capacity at destruction. This
+// default does nothing and compiles away; vector_stats.h provides a policy
+// that feeds a global registry.
+struct NoVectorStats {
+	static constexpr void OnAllocate(size_t) noexcept {
+
+	}
+
+	static constexpr void OnRelocate(size_t, size_t, size_t) noexcept {
+
+	}
+
+	static constexpr void OnShift(size_t) noexcept {
+
+	}
+
+	static constexpr void OnRelease(size_t, size_t) noexcept {
+
+	}
+};
+
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowthPolicy,
+	typename Stats = NoVectorStats>
 class Vector {
+	using AllocTraits = std::allocator_traits<Alloc>;
+
 public:
+#if defined(VECTOR_HARDENED)
+	using iterator = detail::CheckedIterator<Vector, T>;
+	using const_iterator = detail::CheckedIterator<const Vector, const T>;
+#else
 	using iterator = T*;
 	using const_iterator = const T*;
+#endif
+	using allocator_type = Alloc;
 
-	Vector() noexcept
-		: data_(RawMemory<T>()), size_(0) {
+	VECTOR_CONSTEXPR20 Vector() noexcept(noexcept(Alloc()))
+		: data_(RawMemory<T, Alloc>()), size_(0) {
 
 	}
 
-	Vector(size_t size)
-		: data_(RawMemory<T>(size)), size_(size) {
-		std::uninitialized_value_construct_n(data_.GetAddress(), Size());
+	VECTOR_CONSTEXPR20 explicit Vector(const Alloc& alloc) noexcept
+		: data_(RawMemory<T, Alloc>(alloc)), size_(0) {
+
 	}
 
-	Vector(const Vector& other)
-		: data_(RawMemory<T>(other.Size())), size_(other.Size()) {
-		std::uninitialized_copy_n(other.data_.GetAddress(), Size(), data_.GetAddress());
+	VECTOR_CONSTEXPR20 Vector(size_t size, const Alloc& alloc = Alloc())
+		: data_(NewStorage(size, alloc)), size_(size) {
+		detail::UninitializedValueConstructN(data_.GetAddress(), Size());
 	}
 
-	Vector(Vector&& other) noexcept {
-		data_ = std::move(other.data_);
-		size_ = std::move(other.size_);
-		other.size_ = 0;
+	Vector(size_t size, DefaultInitTag, const Alloc& alloc = Alloc())
+		: data_(NewStorage(size, alloc)), size_(size) {
+		std::uninitialized_default_construct_n(data_.GetAddress(), Size());
 	}
 
-	Vector& operator=(const Vector& rhs) {
-		if (rhs.Size() > data_.Capacity()) {
-			Vector rhs_copy(rhs);
-			Swap(rhs_copy);
+	template <typename Policy, typename = std::enable_if_t<IsExecutionPolicyV<Policy>>>
+	Vector(size_t size, Policy&& policy, const Alloc& alloc = Alloc())
+		: data_(NewStorage(size, alloc)), size_(0) {
+		T* dst = data_.GetAddress();
+		detail::ParallelUninitializedChunks(policy, dst, size, [dst](size_t begin, size_t end) {
+			std::uninitialized_value_construct_n(dst + begin, end - begin);
+		});
+		size_ = size;
+	}
+
+	template <typename Policy, typename = std::enable_if_t<IsExecutionPolicyV<Policy>>>
+	Vector(size_t size, const T& value, Policy&& policy, const Alloc& alloc = Alloc())
+		: data_(NewStorage(size, alloc)), size_(0) {
+		T* dst = data_.GetAddress();
+		detail::ParallelUninitializedChunks(policy, dst, size, [dst, &value](size_t begin, size_t end) {
+			std::uninitialized_fill_n(dst + begin, end - begin, value);
+		});
+		size_ = size;
+	}
+
+	VECTOR_CONSTEXPR20 Vector(const Vector& other)
+		: Vector(other, AllocTraits::select_on_container_copy_construction(other.GetAllocator())) {
+
+	}
+
+	VECTOR_CONSTEXPR20 Vector(const Vector& other, const Alloc& alloc)
+		: data_(NewStorage(other.Size(), alloc)), size_(other.Size()) {
+		detail::UninitializedCopyN(other.data_.GetAddress(), Size(), data_.GetAddress());
+	}
+
+	VECTOR_CONSTEXPR20 Vector(Vector&& other) noexcept
+		: data_(std::move(other.data_)), size_(std::exchange(other.size_, 0)) {
+
+	}
+
+	VECTOR_CONSTEXPR20 Vector(Vector&& other, const Alloc& alloc)
+		: data_(RawMemory<T, Alloc>(alloc)), size_(0) {
+		if (alloc == other.GetAllocator()) {
+			data_.Swap(other.data_);
+			std::swap(size_, other.size_);
+		} else {
+			AnnotationScope annotation(*this);
+			AssignElements(std::move(other));
+		}
+	}
+
+	VECTOR_CONSTEXPR20 Vector& operator=(const Vector& rhs) {
+		AnnotationScope annotation(*this);
+		if (this == &rhs) {
 			return *this;
 		}
 
-		if (rhs.Size() < Size()) {
-			for (size_t i = 0; i < rhs.Size(); ++i) {
-				data_[i] = rhs[i];
-			}
-			std::destroy_n(data_.GetAddress() + rhs.Size(), Size() - rhs.Size());
-		} else {
-			for (size_t i = 0; i < Size(); ++i) {
-				data_[i] = rhs[i];
+		if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+			if (GetAllocator() != rhs.GetAllocator()) {
+				Clear();
+				data_.Reset(rhs.GetAllocator());
+			} else {
+				data_.SetAllocator(rhs.GetAllocator());
 			}
-			std::uninitialized_copy_n(rhs.data_.GetAddress() + Size(), rhs.Size() - Size(), data_.GetAddress() + Size());
 		}
 
-		size_ = rhs.size_;
+		AssignElements(rhs);
 		return *this;
 	}
 
-	Vector& operator=(Vector&& rhs) noexcept {
-		data_ = std::move(rhs.data_);
-		size_ = std::move(rhs.size_);
-		rhs.size_ = 0;
+	VECTOR_CONSTEXPR20 Vector& operator=(Vector&& rhs) noexcept(AllocTraits::propagate_on_container_move_assignment::value
+		|| AllocTraits::is_always_equal::value) {
+		if (this == &rhs) {
+			return *this;
+		}
+
+		AnnotationScope annotation(*this);
+		if constexpr (AllocTraits::propagate_on_container_move_assignment::value
+			|| AllocTraits::is_always_equal::value) {
+			StealFrom(rhs);
+		} else {
+			if (GetAllocator() == rhs.GetAllocator()) {
+				StealFrom(rhs);
+			} else {
+				AssignElements(std::move(rhs));
+			}
+		}
 		return *this;
 	}
 
-	~Vector() {
+	VECTOR_CONSTEXPR20 ~Vector() {
+		Stats::OnRelease(Size(), Capacity());
+		Annotate(Size(), Capacity());
 		std::destroy_n(data_.GetAddress(), Size());
 	}
 
-	iterator begin() noexcept {
-		return data_.GetAddress();
+	VECTOR_CONSTEXPR20 iterator begin() noexcept {
+		return MakeIterator(Data());
 	}
 
-	iterator end() noexcept {
-		return data_.GetAddress() + Size();
+	VECTOR_CONSTEXPR20 iterator end() noexcept {
+		return MakeIterator(Data() + Size());
 	}
 
-	const_iterator begin() const noexcept {
+	VECTOR_CONSTEXPR20 const_iterator begin() const noexcept {
 		return cbegin();
 	}
 
-	const_iterator end() const noexcept {
+	VECTOR_CONSTEXPR20 const_iterator end() const noexcept {
 		return cend();
 	}
 
-	const_iterator cbegin() const noexcept {
+	VECTOR_CONSTEXPR20 const_iterator cbegin() const noexcept {
+		return MakeIterator(Data());
+	}
+
+	VECTOR_CONSTEXPR20 const_iterator cend() const noexcept {
+		return MakeIterator(Data() + Size());
+	}
+
+	VECTOR_CONSTEXPR20 T* Data() noexcept {
 		return data_.GetAddress();
 	}
 
-	const_iterator cend() const noexcept {
-		return data_.GetAddress() + Size();
+	VECTOR_CONSTEXPR20 const T* Data() const noexcept {
+		return data_.GetAddress();
 	}
 
 	template <typename... Args>
-	iterator Emplace(const_iterator position, Args&&... args) {
-		int pos = position - begin();
+	VECTOR_CONSTEXPR20 iterator Emplace(const_iterator position, Args&&... args) {
+		AnnotationScope annotation(*this);
+		size_t pos = Index(position);
 
 		if (data_.Capacity() > Size()) {
+			Stats::OnShift(Size() - pos);
+			detail::EmplaceShift(Data(), size_, pos, std::forward<Args>(args)...);
+		} else {
+			RawMemory<T, Alloc> new_data = NewStorage(NextCapacity(Size() + 1), GetAllocator());
+			detail::ConstructAt(new_data.GetAddress() + pos, std::forward<Args>(args)...);
+			detail::RelocateAroundN(data_.GetAddress(), Size(), pos, new_data.GetAddress());
+			data_.Swap(new_data);
+			Stats::OnRelocate(Size(), Size() * sizeof(T), data_.Capacity());
+			size_++;
+		}
+		return begin() + pos;
+	}
+
+	VECTOR_CONSTEXPR20 iterator Erase(const_iterator position) {
+		AnnotationScope annotation(*this);
+		size_t pos = Index(position);
+		VECTOR_CHECK(pos < Size(), "Erase of the end iterator");
+		Stats::OnShift(Size() - pos - 1);
+		detail::EraseShiftN(Data(), Size(), pos, 1);
+		size_--;
+		return (begin() + pos);
+	}
+
+	VECTOR_CONSTEXPR20 iterator Erase(const_iterator first, const_iterator last) {
+		AnnotationScope annotation(*this);
+		size_t pos = Index(first);
+		size_t end_pos = Index(last);
+		VECTOR_CHECK(pos <= end_pos, "Erase range is reversed");
+		size_t count = end_pos - pos;
+		if (count == 0) {
+			return begin() + pos;
+		}
+
+		Stats::OnShift(Size() - pos - count);
+		detail::EraseShiftN(Data(), Size(), pos, count);
+		size_ -= count;
+		return begin() + pos;
+	}
+
+	// Removes every element matching pred in a single compaction pass and
+	// returns how many were removed. The order of the rest is preserved.
+	template <typename Predicate>
+	size_t EraseIf(Predicate pred) {
+		AnnotationScope annotation(*this);
+		T* data = Data();
+		T* last = data + Size();
+		T* first = std::find_if(data, last, pred);
+		if (first == last) {
+			return 0;
+		}
+
+		size_t old_size = Size();
+		if constexpr (IsTriviallyRelocatableV<T>) {
+			T* write = first;
+			T* read = first;
 			try {
-				if (position != end()) {
-					T tmp_obj(std::forward<Args>(args)...);
-					new (end()) T(std::forward<T>(data_[Size() - 1]));
-					std::move_backward(begin() + pos, end() - 1, end());
-					*(begin() + pos) = std::forward<T>(tmp_obj);
-				} else {
-					new (end()) T(std::forward<Args>(args)...);
+				while (read != last) {
+					std::destroy_at(read++);
+					T* run_end = std::find_if(read, last, pred);
+					detail::MemMoveN(read, run_end - read, write);
+					write += run_end - read;
+					read = run_end;
 				}
 			} catch (...) {
-				operator delete (end());
+				detail::MemMoveN(read, last - read, write);
+				size_ = write - data + (last - read);
 				throw;
 			}
+			size_ = write - data;
 		} else {
-			RawMemory<T> new_data(Size() == 0 ? 1 : Size() * 2);
-			new (new_data.GetAddress() + pos) T(std::forward<Args>(args)...);
-
-			if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
-				std::uninitialized_move_n(data_.GetAddress(), pos, new_data.GetAddress());
-			} else {
-				std::uninitialized_copy_n(data_.GetAddress(), pos, new_data.GetAddress());
+			T* write = first;
+			for (T* read = first + 1; read != last; ++read) {
+				if (!pred(*read)) {
+					*write++ = std::move(*read);
+				}
 			}
+			Erase(begin() + (write - data), end());
+		}
+		return old_size - Size();
+	}
 
-			if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
-				std::uninitialized_move_n(data_.GetAddress() + pos, Size() - pos, new_data.GetAddress() + pos + 1);
+	// Removes the element at position by moving the last element into its
+	// place. O(1), but does not preserve the order of the elements.
+	iterator SwapErase(const_iterator position) {
+		AnnotationScope annotation(*this);
+		size_t pos = Index(position);
+		VECTOR_CHECK(pos < Size(), "SwapErase of the end iterator");
+		T* hole = Data() + pos;
+		T* last = Data() + Size() - 1;
+		if (hole != last) {
+			if constexpr (IsTriviallyRelocatableV<T>) {
+				std::destroy_at(hole);
+				detail::MemCopyN(last, 1, hole);
+				size_--;
+				return begin() + pos;
 			} else {
-				std::uninitialized_copy_n(data_.GetAddress() + pos, Size() - pos, new_data.GetAddress() + pos + 1);
+				*hole = std::move(*last);
 			}
-
-			std::destroy_n(data_.GetAddress(), Size());
-			data_.Swap(new_data);
 		}
-		size_++;
+		PopBack();
 		return begin() + pos;
 	}
 
-	iterator Erase(const_iterator position) {
-		int pos = position - begin();
-		std::move(begin() + pos + 1, end(), begin() + pos);
-		std::destroy_at(end() - 1);
-		size_--;
-		return (begin() + pos);
+	// Unordered counterpart of EraseIf: every match is replaced by the current
+	// last element. Returns how many elements were removed.
+	template <typename Predicate>
+	size_t SwapEraseIf(Predicate pred) {
+		AnnotationScope annotation(*this);
+		size_t old_size = Size();
+		for (size_t i = 0; i < Size();) {
+			if (pred(data_[i])) {
+				SwapErase(begin() + i);
+			} else {
+				++i;
+			}
+		}
+		return old_size - Size();
 	}
 
 	iterator Insert(const_iterator position, const T& value) {
@@ -235,104 +1239,463 @@ public:
 		return Emplace(position, std::move(value));
 	}
 
-	void Resize(size_t new_size) {
+	iterator Insert(const_iterator position, size_t count, const T& value) {
+		if constexpr (IsTriviallyRelocatableV<T> && std::is_nothrow_copy_constructible_v<T>) {
+			// value may live inside the vector and get shifted by the fast path.
+			const T value_copy(value);
+			return InsertWith(position, count, [&value_copy, count](T* dst) noexcept {
+				std::uninitialized_fill_n(dst, count, value_copy);
+			});
+		} else {
+			return InsertWith(position, count, [&value, count](T* dst) {
+				std::uninitialized_fill_n(dst, count, value);
+			});
+		}
+	}
+
+	template <typename InputIt, typename = std::enable_if_t<detail::IsInputIteratorV<InputIt>>>
+	iterator Insert(const_iterator position, InputIt first, InputIt last) {
+		if constexpr (detail::IsForwardIteratorV<InputIt>) {
+			constexpr bool nothrow_copy = std::is_pointer_v<InputIt>
+				&& std::is_nothrow_constructible_v<T, decltype(*first)>;
+			size_t count = std::distance(first, last);
+			return InsertWith(position, count, [first, count](T* dst) noexcept(nothrow_copy) {
+				std::uninitialized_copy_n(first, count, dst);
+			});
+		} else {
+			AnnotationScope annotation(*this);
+			size_t pos = Index(position);
+			size_t old_size = Size();
+			for (; first != last; ++first) {
+				EmplaceBack(*first);
+			}
+			std::rotate(Data() + pos, Data() + old_size, Data() + Size());
+			return begin() + pos;
+		}
+	}
+
+	template <typename InputIt, typename = std::enable_if_t<detail::IsInputIteratorV<InputIt>>>
+	void Append(InputIt first, InputIt last) {
+		Insert(end(), first, last);
+	}
+
+	template <typename InputIt, typename = std::enable_if_t<detail::IsInputIteratorV<InputIt>>>
+	void Assign(InputIt first, InputIt last) {
+		AnnotationScope annotation(*this);
+		if constexpr (detail::IsForwardIteratorV<InputIt>) {
+			size_t count = std::distance(first, last);
+			if (count > data_.Capacity()) {
+				RawMemory<T, Alloc> new_data = NewStorage(count, GetAllocator());
+				std::uninitialized_copy_n(first, count, new_data.GetAddress());
+				std::destroy_n(data_.GetAddress(), Size());
+				data_.Swap(new_data);
+			} else if (count <= Size()) {
+				std::copy_n(first, count, Data());
+				std::destroy_n(Data() + count, Size() - count);
+			} else {
+				InputIt mid = std::next(first, Size());
+				std::copy(first, mid, Data());
+				std::uninitialized_copy(mid, last, Data() + Size());
+			}
+			size_ = count;
+		} else {
+			size_t i = 0;
+			for (; i < Size() && first != last; ++i, ++first) {
+				data_[i] = *first;
+			}
+			if (i < Size()) {
+				std::destroy_n(Data() + i, Size() - i);
+				size_ = i;
+			}
+			for (; first != last; ++first) {
+				EmplaceBack(*first);
+			}
+		}
+	}
+
+	VECTOR_CONSTEXPR20 void Resize(size_t new_size) {
+		AnnotationScope annotation(*this);
 		if (new_size == Size()) {
 			return;
 		} else if (new_size < Size()) {
 			std::destroy_n(data_.GetAddress() + new_size, Size() - new_size);
 		} else {
 			Reserve(new_size);
-			std::uninitialized_value_construct_n(data_.GetAddress() + Size(), new_size - Size());
+			detail::UninitializedValueConstructN(data_.GetAddress() + Size(), new_size - Size());
 		}
 		size_ = new_size;
 	}
 
+	// Like Resize, but new elements are default-initialized, so trivial types
+	// are left with indeterminate values for the caller to overwrite.
+	void ResizeForOverwrite(size_t new_size) {
+		AnnotationScope annotation(*this);
+		if (new_size <= Size()) {
+			Resize(new_size);
+			return;
+		}
+		Reserve(new_size);
+		std::uninitialized_default_construct_n(data_.GetAddress() + Size(), new_size - Size());
+		size_ = new_size;
+	}
+
+	// Grows or shrinks to new_size with default-initialized new elements, then
+	// calls op(data, new_size), which fills the buffer and returns how many
+	// leading elements are valid. The vector is truncated to that count.
+	template <typename Operation>
+	void ResizeAndOverwrite(size_t new_size, Operation op) {
+		AnnotationScope annotation(*this);
+		size_t old_size = std::min(Size(), new_size);
+		ResizeForOverwrite(new_size);
+
+		size_t written = 0;
+		try {
+			written = static_cast<size_t>(std::move(op)(data_.GetAddress(), new_size));
+		} catch (...) {
+			Resize(old_size);
+			throw;
+		}
+		VECTOR_CHECK(written <= new_size, "ResizeAndOverwrite operation returned more than new_size");
+		Resize(written);
+	}
+
 	template<typename Type>
-	void PushBack(Type&& value) {
+	VECTOR_CONSTEXPR20 void PushBack(Type&& value) {
+		AnnotationScope annotation(*this);
 		if (data_.Capacity() > Size()) {
-			new (data_.GetAddress() + Size()) T(std::forward<Type>(value));
+			detail::ConstructAt(data_.GetAddress() + Size(), std::forward<Type>(value));
 		} else {
-			RawMemory<T> new_data(Size() == 0 ? 1 : Size() * 2);
-			new (new_data.GetAddress() + Size()) T(std::forward<Type>(value));
-			if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
-				std::uninitialized_move_n(data_.GetAddress(), Size(), new_data.GetAddress());
-			} else {
-				std::uninitialized_copy_n(data_.GetAddress(), Size(), new_data.GetAddress());
-			}
-			std::destroy_n(data_.GetAddress(), Size());
+			RawMemory<T, Alloc> new_data = NewStorage(NextCapacity(Size() + 1), GetAllocator());
+			detail::ConstructAt(new_data.GetAddress() + Size(), std::forward<Type>(value));
+			detail::RelocateAroundN(data_.GetAddress(), Size(), Size(), new_data.GetAddress());
 			data_.Swap(new_data);
+			Stats::OnRelocate(Size(), Size() * sizeof(T), data_.Capacity());
 		}
 		size_++;
 	}
 
-	void PopBack() {
+	VECTOR_CONSTEXPR20 void PopBack() {
+		AnnotationScope annotation(*this);
+		VECTOR_CHECK(size_ != 0, "PopBack on an empty Vector");
 		std::destroy_n(data_.GetAddress() + Size() - 1, 1);
 		size_--;
 	}
 
-	void Swap(Vector& other) noexcept {
-		RawMemory<T> tmp_data = std::move(other.data_);
-		size_t tmp_size = std::move(other.size_);
+	VECTOR_CONSTEXPR20 void Swap(Vector& other) noexcept {
+		data_.Swap(other.data_);
+		std::swap(size_, other.size_);
+	}
 
-		other.data_ = std::move(data_);
-		other.size_ = std::move(size_);
+	VECTOR_CONSTEXPR20 void Reserve(size_t capacity) {
+		if (data_.Capacity() >= capacity) {
+			return;
+		}
 
-		data_ = std::move(tmp_data);
-		size_ = std::move(tmp_size);
+		AnnotationScope annotation(*this);
+		Reallocate(capacity);
 	}
 
-	void Reserve(size_t capacity) {
+	// Reserve that relocates the elements on the policy's workers. If a copy
+	// throws, the partial copies are destroyed and the vector is unchanged.
+	template <typename Policy, typename = std::enable_if_t<IsExecutionPolicyV<Policy>>>
+	void Reserve(size_t capacity, Policy&& policy) {
 		if (data_.Capacity() >= capacity) {
 			return;
 		}
 
-		std::unique_ptr<RawMemory<T>> new_data = std::make_unique<RawMemory<T>>(capacity);
-		if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
-			std::uninitialized_move_n(data_.GetAddress(), Size(), new_data.get()->GetAddress());
-		} else {
-			std::uninitialized_copy_n(data_.GetAddress(), Size(), new_data.get()->GetAddress());
+		AnnotationScope annotation(*this);
+		RawMemory<T, Alloc> new_data = NewStorage(capacity, GetAllocator());
+		T* src = data_.GetAddress();
+		T* dst = new_data.GetAddress();
+		detail::ParallelUninitializedChunks(policy, dst, Size(), [src, dst](size_t begin, size_t end) {
+			if constexpr (IsTriviallyRelocatableV<T>) {
+				detail::MemCopyN(src + begin, end - begin, dst + begin);
+			} else {
+				detail::UninitializedMoveIfNoexceptN(src + begin, end - begin, dst + begin);
+			}
+		});
+		if constexpr (!IsTriviallyRelocatableV<T>) {
+			detail::ParallelDestroyN(policy, src, Size());
 		}
+		data_.Swap(new_data);
+		Stats::OnRelocate(Size(), Size() * sizeof(T), data_.Capacity());
+	}
+
+	// Copy of the vector built on the policy's workers, so the pages of the
+	// new buffer are first touched by the threads that filled them.
+	template <typename Policy, typename = std::enable_if_t<IsExecutionPolicyV<Policy>>>
+	Vector Copy(Policy&& policy) const {
+		Vector copy(AllocTraits::select_on_container_copy_construction(GetAllocator()));
+		RawMemory<T, Alloc> new_data = NewStorage(Size(), copy.GetAllocator());
+		const T* src = data_.GetAddress();
+		T* dst = new_data.GetAddress();
+		detail::ParallelUninitializedChunks(policy, dst, Size(), [src, dst](size_t begin, size_t end) {
+			std::uninitialized_copy_n(src + begin, end - begin, dst + begin);
+		});
+		copy.data_.Swap(new_data);
+		copy.size_ = Size();
+		return copy;
+	}
+
+	// Reallocates to exactly Size() elements, releasing the spare capacity.
+	void ShrinkToFit() {
+		AnnotationScope annotation(*this);
+		if (data_.Capacity() == Size()) {
+			return;
+		}
+		Reallocate(Size());
+	}
+
+	// Destroys all elements but keeps the buffer for reuse.
+	VECTOR_CONSTEXPR20 void Clear() noexcept {
+		AnnotationScope annotation(*this);
 		std::destroy_n(data_.GetAddress(), Size());
-		data_.Swap(*new_data);
+		size_ = 0;
 	}
 
-	size_t Size() const noexcept {
+	// Destroys all elements and frees the buffer.
+	void ClearAndRelease() noexcept {
+		AnnotationScope annotation(*this);
+		Clear();
+		RawMemory<T, Alloc> empty(GetAllocator());
+		data_.Swap(empty);
+	}
+
+	VECTOR_CONSTEXPR20 size_t Size() const noexcept {
 		return size_;
 	}
 
-	size_t Capacity() const noexcept {
+	VECTOR_CONSTEXPR20 size_t Capacity() const noexcept {
 		return data_.Capacity();
 	}
 
+	VECTOR_CONSTEXPR20 const Alloc& GetAllocator() const noexcept {
+		return data_.GetAllocator();
+	}
+
 	template <typename... Args>
-	T& EmplaceBack(Args&&... args) {
+	VECTOR_CONSTEXPR20 T& EmplaceBack(Args&&... args) {
+		AnnotationScope annotation(*this);
 		if (data_.Capacity() > Size()) {
-			new (data_.GetAddress() + Size()) T(std::forward<Args>(args)...);
+			detail::ConstructAt(data_.GetAddress() + Size(), std::forward<Args>(args)...);
 		} else {
-			RawMemory<T> new_data(Size() == 0 ? 1 : Size() * 2);
-			new (new_data.GetAddress() + Size()) T(std::forward<Args>(args)...);
-			if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
-				std::uninitialized_move_n(data_.GetAddress(), Size(), new_data.GetAddress());
-			} else {
-				std::uninitialized_copy_n(data_.GetAddress(), Size(), new_data.GetAddress());
-			}
-			std::destroy_n(data_.GetAddress(), Size());
+			RawMemory<T, Alloc> new_data = NewStorage(NextCapacity(Size() + 1), GetAllocator());
+			detail::ConstructAt(new_data.GetAddress() + Size(), std::forward<Args>(args)...);
+			detail::RelocateAroundN(data_.GetAddress(), Size(), Size(), new_data.GetAddress());
 			data_.Swap(new_data);
+			Stats::OnRelocate(Size(), Size() * sizeof(T), data_.Capacity());
 		}
 		return data_[size_++];
 	}
 
-	const T& operator[](size_t index) const noexcept {
+	VECTOR_CONSTEXPR20 const T& operator[](size_t index) const noexcept {
+		VECTOR_CHECK(index < size_, "Vector index out of range");
 		return data_[index];
 	}
 
-	T& operator[](size_t index) noexcept {
-		assert(index < size_);
+	VECTOR_CONSTEXPR20 T& operator[](size_t index) noexcept {
+		VECTOR_CHECK(index < size_, "Vector index out of range");
 		return data_[index];
 	}
 
 private:
-	RawMemory<T> data_;
+#if defined(VECTOR_HARDENED)
+	friend iterator;
+	friend const_iterator;
+
+	VECTOR_CONSTEXPR20 uint64_t Generation() const noexcept {
+		return data_.Generation();
+	}
+
+	VECTOR_CONSTEXPR20 iterator MakeIterator(T* pointer) noexcept {
+		return iterator(this, pointer);
+	}
+
+	VECTOR_CONSTEXPR20 const_iterator MakeIterator(const T* pointer) const noexcept {
+		return const_iterator(this, pointer);
+	}
+
+	VECTOR_CONSTEXPR20 size_t Index(const_iterator position) const noexcept {
+		VECTOR_CHECK(position.Owner() == this, "iterator of another container");
+		position.CheckValid();
+		return position.Base() - Data();
+	}
+#else
+	static VECTOR_CONSTEXPR20 iterator MakeIterator(T* pointer) noexcept {
+		return pointer;
+	}
+
+	static VECTOR_CONSTEXPR20 const_iterator MakeIterator(const T* pointer) noexcept {
+		return pointer;
+	}
+
+	VECTOR_CONSTEXPR20 size_t Index(const_iterator position) const noexcept {
+		assert(position >= Data() && position <= Data() + Size());
+		return position - Data();
+	}
+#endif
+
+	// Under AddressSanitizer in hardened builds [Size(), Capacity()) is kept
+	// poisoned between calls. Mutators hold a scope, which makes the whole
+	// buffer addressable while they run and poisons the spare capacity of
+	// whatever buffer they end up with, so every buffer adopted during the
+	// call must be fully addressable as well. Scopes nest.
+	class AnnotationScope {
+	public:
+		VECTOR_CONSTEXPR20 explicit AnnotationScope([[maybe_unused]] Vector& vector) noexcept
+#if defined(VECTOR_ANNOTATE_CONTAINER)
+			: vector_(vector) {
+			if (vector_.annotation_depth_++ == 0) {
+				vector_.Annotate(vector_.Size(), vector_.Capacity());
+			}
+		}
+
+		VECTOR_CONSTEXPR20 ~AnnotationScope() {
+			if (--vector_.annotation_depth_ == 0) {
+				vector_.Annotate(vector_.Capacity(), vector_.Size());
+			}
+		}
+
+	private:
+		Vector& vector_;
+#else
+		{
+
+		}
+#endif
+	};
+
+	VECTOR_CONSTEXPR20 void Annotate([[maybe_unused]] size_t old_size, [[maybe_unused]] size_t new_size) const noexcept {
+#if defined(VECTOR_ANNOTATE_CONTAINER)
+		if (data_.Capacity() != 0 && !detail::IsConstantEvaluated()) {
+			const T* first = data_.GetAddress();
+			__sanitizer_annotate_contiguous_container(first, first + data_.Capacity(),
+				first + old_size, first + new_size);
+		}
+#endif
+	}
+
+	static VECTOR_CONSTEXPR20 RawMemory<T, Alloc> NewStorage(size_t capacity, const Alloc& alloc) {
+		if (capacity != 0) {
+			Stats::OnAllocate(capacity * sizeof(T));
+		}
+		return RawMemory<T, Alloc>(capacity, alloc);
+	}
+
+	VECTOR_CONSTEXPR20 size_t NextCapacity(size_t required) const noexcept {
+		return Growth::template NextCapacity<T>(data_.Capacity(), required);
+	}
+
+	// Opens a hole of count elements at position and lets fill construct them
+	// in place. The vector is reallocated at most once. fill must either
+	// construct all count elements or destroy what it built and throw.
+	template <typename Fill>
+	iterator InsertWith(const_iterator position, size_t count, Fill fill) {
+		AnnotationScope annotation(*this);
+		size_t pos = Index(position);
+		if (count == 0) {
+			return begin() + pos;
+		}
+
+		if (Size() + count > data_.Capacity()) {
+			RawMemory<T, Alloc> new_data = NewStorage(NextCapacity(Size() + count), GetAllocator());
+			fill(new_data.GetAddress() + pos);
+			detail::RelocateAroundN(data_.GetAddress(), Size(), pos, new_data.GetAddress(), count);
+			data_.Swap(new_data);
+			Stats::OnRelocate(Size(), Size() * sizeof(T), data_.Capacity());
+		} else if constexpr (IsTriviallyRelocatableV<T> && std::is_nothrow_invocable_v<Fill&, T*>) {
+			Stats::OnShift(Size() - pos);
+			detail::MemMoveN(Data() + pos, Size() - pos, Data() + pos + count);
+			fill(Data() + pos);
+		} else {
+			Stats::OnShift(Size() - pos);
+			fill(Data() + Size());
+			size_ += count;
+			std::rotate(Data() + pos, Data() + Size() - count, Data() + Size());
+			return begin() + pos;
+		}
+		size_ += count;
+		return begin() + pos;
+	}
+
+	VECTOR_CONSTEXPR20 void Reallocate(size_t capacity) {
+		RawMemory<T, Alloc> new_data = NewStorage(capacity, GetAllocator());
+		detail::UninitializedRelocateN(data_.GetAddress(), Size(), new_data.GetAddress());
+		data_.Swap(new_data);
+		Stats::OnRelocate(Size(), Size() * sizeof(T), data_.Capacity());
+	}
+
+	VECTOR_CONSTEXPR20 void StealFrom(Vector& rhs) noexcept {
+		rhs.Annotate(rhs.Size(), rhs.Capacity());
+		std::destroy_n(data_.GetAddress(), Size());
+		data_ = std::move(rhs.data_);
+		size_ = std::exchange(rhs.size_, 0);
+	}
+
+	// Element-wise assignment into the current buffer, reallocating with our
+	// own allocator when it is too small. Moves the elements when rhs is an
+	// rvalue, which is how unequal non-propagating allocators are handled.
+	template <typename Other>
+	VECTOR_CONSTEXPR20 void AssignElements(Other&& rhs) {
+		using Ref = std::conditional_t<std::is_lvalue_reference_v<Other>, const T&, T&&>;
+		T* src = const_cast<T*>(rhs.data_.GetAddress());
+
+		if (rhs.Size() > data_.Capacity()) {
+			RawMemory<T, Alloc> new_data = NewStorage(rhs.Size(), GetAllocator());
+			if constexpr (std::is_lvalue_reference_v<Other>) {
+				detail::UninitializedCopyN(src, rhs.Size(), new_data.GetAddress());
+			} else {
+				detail::UninitializedMoveN(src, rhs.Size(), new_data.GetAddress());
+			}
+			std::destroy_n(data_.GetAddress(), Size());
+			data_.Swap(new_data);
+		} else if (rhs.Size() < Size()) {
+			for (size_t i = 0; i < rhs.Size(); ++i) {
+				data_[i] = static_cast<Ref>(src[i]);
+			}
+			std::destroy_n(data_.GetAddress() + rhs.Size(), Size() - rhs.Size());
+		} else {
+			for (size_t i = 0; i < Size(); ++i) {
+				data_[i] = static_cast<Ref>(src[i]);
+			}
+			if constexpr (std::is_lvalue_reference_v<Other>) {
+				detail::UninitializedCopyN(src + Size(), rhs.Size() - Size(), data_.GetAddress() + Size());
+			} else {
+				detail::UninitializedMoveN(src + Size(), rhs.Size() - Size(), data_.GetAddress() + Size());
+			}
+		}
+
+		size_ = rhs.size_;
+		if constexpr (!std::is_lvalue_reference_v<Other>) {
+			std::destroy_n(src, rhs.size_);
+			rhs.Annotate(rhs.size_, 0);
+			rhs.size_ = 0;
+		}
+	}
+
+	RawMemory<T, Alloc> data_;
 	size_t size_ = 0;
+#if defined(VECTOR_ANNOTATE_CONTAINER)
+	int annotation_depth_ = 0;
+#endif
+
+};
+
+template <typename T, typename Alloc, typename Growth, typename Stats, typename Predicate>
+size_t EraseIf(Vector<T, Alloc, Growth, Stats>& vector, Predicate pred) {
+	return vector.EraseIf(pred);
+}
+
+template <typename T, typename Alloc, typename Growth, typename Stats, typename U>
+size_t Erase(Vector<T, Alloc, Growth, Stats>& vector, const U& value) {
+	return vector.EraseIf([&value](const T& element) {
+		return element == value;
+	});
+}
+
+namespace pmr {
+
+template <typename T>
+using Vector = ::Vector<T, std::pmr::polymorphic_allocator<T>, DefaultGrowthPolicy>;
 
-};
\ No newline at end of file
+}
\ No newline at end of file
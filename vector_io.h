@@ -0,0 +1,389 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Wire format, native byte order:
+//
+//	Serialize:        uint64 count, then count encoded elements
+//	SerializeChunked: frames of (uint64 count, count elements), ended by a
+//	                  frame with count == 0
+//
+// Trivially copyable elements are written as their raw bytes. Other types
+// are encoded through VectorCodec<T>, which can be specialized.
+//
+// A Writer provides Write(const void*, size_t) and may provide
+// WriteV(iovec*, int); a Reader provides Read(void*, size_t), which fills
+// the whole range or throws, and may provide ReadV(iovec*, int). The
+// vectored forms may modify the iovec array while retrying partial
+// transfers. A Reader may also provide CanReadAhead(), true when reading
+// past the end of a frame never waits for data that has not been sent yet,
+// as for regular files.
+
+template <typename T, typename = void>
+struct VectorCodec;
+
+template <typename CharT, typename Traits, typename Alloc>
+struct VectorCodec<std::basic_string<CharT, Traits, Alloc>> {
+	using String = std::basic_string<CharT, Traits, Alloc>;
+
+	template <typename Writer>
+	static void Encode(Writer& writer, const String& value) {
+		uint64_t length = value.size();
+		writer.Write(&length, sizeof(length));
+		writer.Write(value.data(), value.size() * sizeof(CharT));
+	}
+
+	template <typename Reader>
+	static String Decode(Reader& reader) {
+		uint64_t length = 0;
+		reader.Read(&length, sizeof(length));
+		String value;
+		value.resize(length);
+		reader.Read(value.data(), length * sizeof(CharT));
+		return value;
+	}
+};
+
+namespace detail {
+
+// Skips the first bytes of an iovec array after a partial readv/writev.
+inline iovec* AdvanceIov(iovec* first, iovec* last, size_t bytes) noexcept {
+	for (; first != last && bytes >= first->iov_len; ++first) {
+		bytes -= first->iov_len;
+	}
+	if (first != last) {
+		first->iov_base = static_cast<char*>(first->iov_base) + bytes;
+		first->iov_len -= bytes;
+	}
+	return first;
+}
+
+}
+
+// Writer over a file descriptor or socket. Vectored writes go out in a single
+// writev call whenever the kernel accepts them in full.
+class FdWriter {
+public:
+	explicit FdWriter(int fd) noexcept
+		: fd_(fd) {
+
+	}
+
+	void Write(const void* data, size_t bytes) {
+		iovec iov{const_cast<void*>(data), bytes};
+		WriteV(&iov, 1);
+	}
+
+	void WriteV(iovec* iov, int count) {
+		iovec* first = iov;
+		iovec* last = iov + count;
+		while (first != last) {
+			ssize_t written = writev(fd_, first, static_cast<int>(last - first));
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw std::system_error(errno, std::generic_category(), "writev");
+			}
+			first = detail::AdvanceIov(first, last, static_cast<size_t>(written));
+		}
+	}
+
+private:
+	int fd_;
+};
+
+class FdReader {
+public:
+	explicit FdReader(int fd) noexcept
+		: fd_(fd), regular_file_(IsRegularFile(fd)) {
+
+	}
+
+	// Regular files have all their data already; sockets and pipes may not.
+	bool CanReadAhead() const noexcept {
+		return regular_file_;
+	}
+
+	void Read(void* data, size_t bytes) {
+		iovec iov{data, bytes};
+		ReadV(&iov, 1);
+	}
+
+	void ReadV(iovec* iov, int count) {
+		iovec* first = iov;
+		iovec* last = iov + count;
+		while (first != last) {
+			ssize_t received = readv(fd_, first, static_cast<int>(last - first));
+			if (received < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw std::system_error(errno, std::generic_category(), "readv");
+			}
+			if (received == 0) {
+				throw std::runtime_error("FdReader: unexpected end of input");
+			}
+			first = detail::AdvanceIov(first, last, static_cast<size_t>(received));
+		}
+	}
+
+private:
+	static bool IsRegularFile(int fd) noexcept {
+		struct stat st;
+		return fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+	}
+
+	int fd_;
+	bool regular_file_;
+};
+
+class StreamWriter {
+public:
+	explicit StreamWriter(std::ostream& out) noexcept
+		: out_(out) {
+
+	}
+
+	void Write(const void* data, size_t bytes) {
+		if (!out_.write(static_cast<const char*>(data), bytes)) {
+			throw std::runtime_error("StreamWriter: write failed");
+		}
+	}
+
+private:
+	std::ostream& out_;
+};
+
+class StreamReader {
+public:
+	explicit StreamReader(std::istream& in) noexcept
+		: in_(in) {
+
+	}
+
+	void Read(void* data, size_t bytes) {
+		if (!in_.read(static_cast<char*>(data), bytes)) {
+			throw std::runtime_error("StreamReader: unexpected end of input");
+		}
+	}
+
+private:
+	std::istream& in_;
+};
+
+namespace detail {
+
+template <typename Stream, typename = void>
+inline constexpr bool HasVectoredWriteV = false;
+
+template <typename Stream>
+inline constexpr bool HasVectoredWriteV<Stream, std::void_t<decltype(std::declval<Stream&>().WriteV(nullptr, 0))>> = true;
+
+template <typename Stream, typename = void>
+inline constexpr bool HasVectoredReadV = false;
+
+template <typename Stream>
+inline constexpr bool HasVectoredReadV<Stream, std::void_t<decltype(std::declval<Stream&>().ReadV(nullptr, 0))>> = true;
+
+template <typename Stream, typename = void>
+inline constexpr bool HasReadAheadV = false;
+
+template <typename Stream>
+inline constexpr bool HasReadAheadV<Stream, std::void_t<decltype(std::declval<const Stream&>().CanReadAhead())>> = true;
+
+// Writes a count prefix and a payload, in one WriteV call when available.
+template <typename Writer>
+void WriteFrame(Writer& writer, const uint64_t& count, const void* payload, size_t bytes) {
+	if constexpr (HasVectoredWriteV<Writer>) {
+		iovec iov[2] = {{const_cast<uint64_t*>(&count), sizeof(count)}, {const_cast<void*>(payload), bytes}};
+		writer.WriteV(iov, bytes != 0 ? 2 : 1);
+	} else {
+		writer.Write(&count, sizeof(count));
+		if (bytes != 0) {
+			writer.Write(payload, bytes);
+		}
+	}
+}
+
+// Collects the many small writes of per-element encoding into large blocks.
+template <typename Writer>
+class BufferedWriter {
+public:
+	static constexpr size_t kFlushBytes = size_t(64) << 10;
+
+	explicit BufferedWriter(Writer& writer)
+		: writer_(writer) {
+		buffer_.Reserve(kFlushBytes);
+	}
+
+	void Write(const void* data, size_t bytes) {
+		const char* first = static_cast<const char*>(data);
+		buffer_.Append(first, first + bytes);
+		if (buffer_.Size() >= kFlushBytes) {
+			Flush();
+		}
+	}
+
+	void Flush() {
+		if (buffer_.Size() != 0) {
+			writer_.Write(buffer_.Data(), buffer_.Size());
+			buffer_.Clear();
+		}
+	}
+
+private:
+	Writer& writer_;
+	Vector<char> buffer_;
+};
+
+inline size_t CheckedByteCount(uint64_t count, size_t element_size) {
+	if (count > SIZE_MAX / element_size) {
+		throw std::length_error("Vector payload is too large");
+	}
+	return static_cast<size_t>(count) * element_size;
+}
+
+template <typename T, typename Writer>
+void WriteElements(Writer& writer, const T* first, size_t count) {
+	uint64_t header = count;
+	if constexpr (std::is_trivially_copyable_v<T>) {
+		WriteFrame(writer, header, first, count * sizeof(T));
+	} else {
+		BufferedWriter<Writer> buffered(writer);
+		buffered.Write(&header, sizeof(header));
+		for (size_t i = 0; i < count; ++i) {
+			VectorCodec<T>::Encode(buffered, first[i]);
+		}
+		buffered.Flush();
+	}
+}
+
+// Counts come from the wire, so at most this much is allocated ahead of the
+// payload that has actually arrived; a bogus count fails on the read after
+// one step instead of reserving terabytes up front.
+inline constexpr size_t kMaxReadAheadBytes = size_t(64) << 20;
+
+template <typename T>
+size_t ReadStepElements(uint64_t count) noexcept {
+	constexpr size_t max_step = std::max<size_t>(1, kMaxReadAheadBytes / sizeof(T));
+	return count < max_step ? static_cast<size_t>(count) : max_step;
+}
+
+// Makes room for the next count elements, or at least the first read step
+// of them. A run of frames grows with the vector's growth policy, so
+// appending them stays amortized linear instead of reallocating once per
+// frame.
+template <typename T, typename Alloc, typename Growth, typename Stats>
+void ReserveFrame(Vector<T, Alloc, Growth, Stats>& vector, uint64_t count) {
+	CheckedByteCount(count, sizeof(T));
+	size_t required = vector.Size() + ReadStepElements<T>(count);
+	if (required > vector.Capacity()) {
+		vector.Reserve(Growth::template NextCapacity<T>(vector.Capacity(), required));
+	}
+}
+
+// Appends count elements, growing in bounded steps as the payload arrives.
+template <typename T, typename Alloc, typename Growth, typename Stats, typename Reader>
+void ReadElements(Vector<T, Alloc, Growth, Stats>& vector, Reader& reader, uint64_t count) {
+	size_t old_size = vector.Size();
+	if constexpr (std::is_trivially_copyable_v<T>) {
+		CheckedByteCount(count, sizeof(T));
+		try {
+			while (count != 0) {
+				size_t step = ReadStepElements<T>(count);
+				ReserveFrame(vector, step);
+				size_t offset = vector.Size();
+				vector.ResizeForOverwrite(offset + step);
+				reader.Read(vector.Data() + offset, step * sizeof(T));
+				count -= step;
+			}
+		} catch (...) {
+			vector.Resize(old_size);
+			throw;
+		}
+	} else {
+		for (uint64_t i = 0; i < count; ++i) {
+			vector.EmplaceBack(VectorCodec<T>::Decode(reader));
+		}
+	}
+}
+
+}
+
+template <typename T, typename Alloc, typename Growth, typename Stats, typename Writer>
+void Serialize(const Vector<T, Alloc, Growth, Stats>& vector, Writer& writer) {
+	detail::WriteElements(writer, vector.Data(), vector.Size());
+}
+
+// Replaces the contents of vector with the payload read from reader. A
+// payload of up to detail::kMaxReadAheadBytes is reserved once, to the exact
+// element count; larger ones grow in steps as they arrive.
+template <typename T, typename Alloc, typename Growth, typename Stats, typename Reader>
+void Deserialize(Vector<T, Alloc, Growth, Stats>& vector, Reader& reader) {
+	uint64_t count = 0;
+	reader.Read(&count, sizeof(count));
+	detail::CheckedByteCount(count, sizeof(T));
+	vector.Clear();
+	vector.Reserve(detail::ReadStepElements<T>(count));
+	detail::ReadElements(vector, reader, count);
+}
+
+template <typename T, typename Alloc, typename Growth, typename Stats, typename Writer>
+void SerializeChunked(const Vector<T, Alloc, Growth, Stats>& vector, Writer& writer, size_t chunk_elements) {
+	assert(chunk_elements != 0);
+	for (size_t offset = 0; offset < vector.Size(); offset += chunk_elements) {
+		detail::WriteElements(writer, vector.Data() + offset, std::min(chunk_elements, vector.Size() - offset));
+	}
+	uint64_t end_marker = 0;
+	writer.Write(&end_marker, sizeof(end_marker));
+}
+
+// Appends the frames of a SerializeChunked payload to vector as they arrive
+// and calls on_chunk(first, count) for each one as soon as it is complete, so
+// processing can start before the whole payload is received. For trivially
+// copyable T and readers with ReadV whose CanReadAhead() is true, each chunk
+// and the header of the next one share one call; on sockets and pipes that
+// would hold every chunk back until the next header arrives.
+template <typename T, typename Alloc, typename Growth, typename Stats, typename Reader, typename Callback>
+void DeserializeChunked(Vector<T, Alloc, Growth, Stats>& vector, Reader& reader, Callback on_chunk) {
+	uint64_t count = 0;
+	reader.Read(&count, sizeof(count));
+	while (count != 0) {
+		size_t offset = vector.Size();
+		detail::ReserveFrame(vector, count);
+		if constexpr (std::is_trivially_copyable_v<T> && detail::HasVectoredReadV<Reader>
+			&& detail::HasReadAheadV<Reader>) {
+			if (reader.CanReadAhead() && count == detail::ReadStepElements<T>(count)) {
+				uint64_t next_count = 0;
+				vector.ResizeForOverwrite(offset + count);
+				iovec iov[2] = {{vector.Data() + offset, static_cast<size_t>(count) * sizeof(T)},
+					{&next_count, sizeof(next_count)}};
+				try {
+					reader.ReadV(iov, 2);
+				} catch (...) {
+					vector.Resize(offset);
+					throw;
+				}
+				on_chunk(static_cast<const T*>(vector.Data() + offset), static_cast<size_t>(count));
+				count = next_count;
+				continue;
+			}
+		}
+		detail::ReadElements(vector, reader, count);
+		on_chunk(static_cast<const T*>(vector.Data() + offset), static_cast<size_t>(count));
+		reader.Read(&count, sizeof(count));
+	}
+}
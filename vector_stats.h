@@ -0,0 +1,156 @@
+#pragma once
+
+#include "vector.h"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Define VECTOR_STATS_USDT to emit a vector:reallocate USDT probe (name,
+// relocated bytes, new capacity) on every growth of an instrumented vector.
+#if defined(VECTOR_STATS_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define VECTOR_STATS_PROBE_REALLOCATE(name, bytes, capacity) DTRACE_PROBE3(vector, reallocate, name, bytes, capacity)
+#endif
+#endif
+
+#ifndef VECTOR_STATS_PROBE_REALLOCATE
+#define VECTOR_STATS_PROBE_REALLOCATE(name, bytes, capacity) ((void)(name), (void)(bytes), (void)(capacity))
+#endif
+
+// Counters shared by every vector of one instrumented call site. All fields
+// are updated with relaxed atomics, so a dump is a consistent-enough
+// snapshot rather than an exact cut.
+struct VectorCounters {
+	explicit VectorCounters(const char* site_name) noexcept
+		: name(site_name) {
+
+	}
+
+	const char* name;
+	std::atomic<uint64_t> allocations{0};
+	std::atomic<uint64_t> allocated_bytes{0};
+	std::atomic<uint64_t> peak_allocation_bytes{0};
+	std::atomic<uint64_t> relocations{0};
+	std::atomic<uint64_t> relocated_bytes{0};
+	std::atomic<uint64_t> shifted_elements{0};
+	std::atomic<uint64_t> releases{0};
+	std::atomic<uint64_t> released_size{0};
+	std::atomic<uint64_t> released_capacity{0};
+	std::atomic<uint64_t> peak_size{0};
+	VectorCounters* next = nullptr;
+};
+
+// Process-wide list of instrumented call sites. Sites register themselves on
+// first use and stay registered until exit.
+class VectorStatsRegistry {
+public:
+	static VectorStatsRegistry& Global() noexcept {
+		static VectorStatsRegistry registry;
+		return registry;
+	}
+
+	void Register(VectorCounters& counters) noexcept {
+		VectorCounters* head = head_.load(std::memory_order_relaxed);
+		do {
+			counters.next = head;
+		} while (!head_.compare_exchange_weak(head, &counters, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	template <typename Function>
+	void ForEach(Function fn) const {
+		for (VectorCounters* site = head_.load(std::memory_order_acquire); site != nullptr; site = site->next) {
+			fn(static_cast<const VectorCounters&>(*site));
+		}
+	}
+
+	// One line per site in key=value form, easy to grep or scrape.
+	void Dump(std::ostream& out) const {
+		ForEach([&out](const VectorCounters& site) {
+			out << site.name
+				<< " allocations=" << site.allocations.load(std::memory_order_relaxed)
+				<< " allocated_bytes=" << site.allocated_bytes.load(std::memory_order_relaxed)
+				<< " peak_allocation_bytes=" << site.peak_allocation_bytes.load(std::memory_order_relaxed)
+				<< " relocations=" << site.relocations.load(std::memory_order_relaxed)
+				<< " relocated_bytes=" << site.relocated_bytes.load(std::memory_order_relaxed)
+				<< " shifted_elements=" << site.shifted_elements.load(std::memory_order_relaxed)
+				<< " releases=" << site.releases.load(std::memory_order_relaxed)
+				<< " released_size=" << site.released_size.load(std::memory_order_relaxed)
+				<< " released_capacity=" << site.released_capacity.load(std::memory_order_relaxed)
+				<< " peak_size=" << site.peak_size.load(std::memory_order_relaxed)
+				<< '\n';
+		});
+	}
+
+	void Reset() noexcept {
+		for (VectorCounters* site = head_.load(std::memory_order_acquire); site != nullptr; site = site->next) {
+			for (std::atomic<uint64_t>* counter : {&site->allocations, &site->allocated_bytes,
+				&site->peak_allocation_bytes, &site->relocations, &site->relocated_bytes, &site->shifted_elements,
+				&site->releases, &site->released_size, &site->released_capacity, &site->peak_size}) {
+				counter->store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	std::atomic<VectorCounters*> head_{nullptr};
+};
+
+// Stats policy that records into the registry under Site::kName:
+//
+//     struct TokenSite { static constexpr const char* kName = "parser.tokens"; };
+//     InstrumentedVector<Token, TokenSite> tokens;
+//
+// Many relocations with a small released_size point at a missing Reserve;
+// released_capacity far above released_size points at wasted memory.
+template <typename Site>
+struct VectorStats {
+	static VectorCounters& Counters() noexcept {
+		static VectorCounters& counters = Registered();
+		return counters;
+	}
+
+	static void OnAllocate(size_t bytes) noexcept {
+		VectorCounters& counters = Counters();
+		counters.allocations.fetch_add(1, std::memory_order_relaxed);
+		counters.allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+		UpdateMax(counters.peak_allocation_bytes, bytes);
+	}
+
+	static void OnRelocate(size_t size, size_t bytes, size_t capacity) noexcept {
+		VectorCounters& counters = Counters();
+		counters.relocations.fetch_add(1, std::memory_order_relaxed);
+		counters.relocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+		UpdateMax(counters.peak_size, size);
+		VECTOR_STATS_PROBE_REALLOCATE(Site::kName, bytes, capacity);
+	}
+
+	static void OnShift(size_t elements) noexcept {
+		Counters().shifted_elements.fetch_add(elements, std::memory_order_relaxed);
+	}
+
+	static void OnRelease(size_t size, size_t capacity) noexcept {
+		VectorCounters& counters = Counters();
+		counters.releases.fetch_add(1, std::memory_order_relaxed);
+		counters.released_size.fetch_add(size, std::memory_order_relaxed);
+		counters.released_capacity.fetch_add(capacity, std::memory_order_relaxed);
+		UpdateMax(counters.peak_size, size);
+	}
+
+private:
+	static VectorCounters& Registered() noexcept {
+		static VectorCounters counters(Site::kName);
+		VectorStatsRegistry::Global().Register(counters);
+		return counters;
+	}
+
+	static void UpdateMax(std::atomic<uint64_t>& peak, uint64_t value) noexcept {
+		uint64_t current = peak.load(std::memory_order_relaxed);
+		while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+		}
+	}
+};
+
+template <typename T, typename Site, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowthPolicy>
+using InstrumentedVector = Vector<T, Alloc, Growth, VectorStats<Site>>;